@@ -0,0 +1,36 @@
+#!/bin/sh
+# Layers the slim and full images share, run last in each stage:
+#   docker-install-agents.sh packages  - apt packages from CUSTOM_PACKAGES
+#   docker-install-agents.sh agents    - Claude Code and the npm-installed agents
+set -e
+
+case "$1" in
+packages)
+	if [ -n "$CUSTOM_PACKAGES" ]; then
+		apt-get update
+		# shellcheck disable=SC2086 # CUSTOM_PACKAGES is a space-separated list
+		DEBIAN_FRONTEND=noninteractive apt-get install -y $CUSTOM_PACKAGES
+		rm -rf /var/lib/apt/lists/*
+	fi
+	;;
+agents)
+	# Install Claude Code via official native installer (no longer npm).
+	# Installer runs as root and places claude under /root/.local/bin by default.
+	# Copy the real binary into a global path so the runtime host-mapped user can execute it.
+	curl -fsSL https://claude.ai/install.sh | bash
+	install -m 0755 "$(readlink -f /root/.local/bin/claude)" /usr/local/bin/claude
+	/usr/local/bin/claude --version
+
+	# Install other CLI coding agents via npm (always fetch latest versions)
+	npm install -g \
+		@openai/codex@latest \
+		opencode-ai@latest \
+		@factory/cli@latest \
+		@google/gemini-cli@latest \
+		@mariozechner/pi-coding-agent@latest
+	;;
+*)
+	echo "usage: $0 packages|agents" >&2
+	exit 2
+	;;
+esac
@@ -11,6 +11,30 @@ source "$CCO_INSTALLATION_DIR/lib/agents/pi.sh"
 # shellcheck source=/dev/null
 source "$CCO_INSTALLATION_DIR/lib/agents/gemini.sh"
 
+# Agent PATH shims are cached by content in
+# ${XDG_CACHE_HOME:-~/.cache}/cco/shims/<agent>-<hash>/<agent>, so a launch
+# with an unchanged shim only checks that it exists. Prints the directory.
+agent_shim_root() {
+	printf '%s/cco/shims\n' "${XDG_CACHE_HOME:-$HOME/.cache}"
+}
+
+agent_shim_dir() {
+	local agent="$1"
+	local script="$2"
+	local dir
+	dir="$(agent_shim_root)/$agent-$(hash_string "$script")"
+	if [[ ! -x "$dir/$agent" ]]; then
+		mkdir -p "$dir" &&
+			printf '%s' "$script" >"$dir/.$agent.$$" &&
+			chmod 755 "$dir/.$agent.$$" &&
+			mv -f "$dir/.$agent.$$" "$dir/$agent" || {
+			rm -f "$dir/.$agent.$$"
+			return 1
+		}
+	fi
+	printf '%s\n' "$dir"
+}
+
 configure_agent_subcommand() {
 	local agent="$1"
 	# shellcheck disable=SC2034  # command_flag is consumed by cco main script after module call.
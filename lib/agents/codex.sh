@@ -124,11 +124,11 @@ configure_codex_mode_paths() {
 	add_rw_path "$resolved_codex_home"
 }
 
-create_codex_mode_shim_dir() {
-	local shim_dir
-	shim_dir=$(mktemp -d "${TMPDIR:-/tmp}/cco-codex-shim.XXXXXX")
-
-	cat >"$shim_dir/codex" <<'EOF'
+# Nested `codex` calls go through this shim, which forces bypass mode and
+# drops sandbox flags before exec'ing the real codex found later on PATH.
+codex_mode_shim_dir() {
+	local script
+	IFS= read -r -d '' script <<'EOF' || true
 #!/usr/bin/env bash
 set -euo pipefail
 
@@ -204,7 +204,5 @@ fi
 cmd+=("${filtered_args[@]}")
 exec "${cmd[@]}"
 EOF
-
-	chmod +x "$shim_dir/codex"
-	echo "$shim_dir"
+	agent_shim_dir codex "$script"
 }
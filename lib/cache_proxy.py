@@ -0,0 +1,418 @@
+#!/usr/bin/env python3
+"""Caching HTTP proxy shared by cco sessions (`cco --cache-proxy`).
+
+cco starts one on demand per user and points sessions at it through
+HTTP(S)_PROXY and the npm/pip/uv registry variables. It listens on
+127.0.0.1, writes its port to ROOT/port, and exits once no session in
+ROOT/sessions is alive and it has been idle for a minute.
+
+  GET http://host/path          plain HTTP proxying (HTTP_PROXY)
+  GET /https/<host>/<path>      mirror of https://<host>/<path>, used for
+                                the npm registry and PyPI
+  CONNECT host:port             tunneled; TLS can't be cached without
+                                intercepting it
+
+Successful GETs of immutable artifacts (package tarballs, wheels, crates,
+release archives) are stored under ROOT/store, keyed by URL, and served
+from there on later requests. Everything else is passed through. PyPI
+simple pages fetched through the mirror have their file links rewritten
+to the mirror, so the wheels and sdists they list are cached as well.
+
+Counters are written to ROOT/stats as "<name> <value>" lines for
+`cco info`.
+"""
+
+import argparse
+import hashlib
+import http.client
+import http.server
+import json
+import os
+import re
+import selectors
+import socket
+import ssl
+import sys
+import tempfile
+import threading
+import time
+import urllib.parse
+
+IDLE_SECONDS = 60
+UPSTREAM_TIMEOUT = 60
+CHUNK = 64 * 1024
+
+HOP_BY_HOP = {
+    "connection",
+    "keep-alive",
+    "proxy-authenticate",
+    "proxy-authorization",
+    "proxy-connection",
+    "te",
+    "trailer",
+    "transfer-encoding",
+    "upgrade",
+}
+
+# Paths whose content never changes once published
+ARTIFACT_RE = re.compile(
+    r"(\.(tgz|tar\.gz|tar\.xz|tar\.bz2|tar\.zst|zip|whl|crate|gem|jar|deb|rpm|apk)"
+    r"|/api/v1/crates/[^/]+/[^/]+/download)$"
+)
+
+STAT_NAMES = ("hits", "misses", "passthrough", "tunnels", "bytes_from_cache", "bytes_fetched")
+
+
+class Proxy:
+    def __init__(self, root):
+        self.root = root
+        self.store = os.path.join(root, "store")
+        self.sessions = os.path.join(root, "sessions")
+        self.lock = threading.Lock()
+        self.stats = dict.fromkeys(STAT_NAMES, 0)
+        self.active = 0
+        self.last_activity = time.monotonic()
+        self.load_stats()
+
+    def load_stats(self):
+        try:
+            with open(os.path.join(self.root, "stats"), encoding="utf-8") as handle:
+                for line in handle:
+                    name, _, value = line.partition(" ")
+                    if name in self.stats and value.strip().isdigit():
+                        self.stats[name] = int(value)
+        except OSError:
+            pass
+
+    def count(self, **deltas):
+        with self.lock:
+            for name, delta in deltas.items():
+                self.stats[name] += delta
+            text = "".join(f"{name} {self.stats[name]}\n" for name in STAT_NAMES)
+            write_atomic(os.path.join(self.root, "stats"), text.encode())
+
+    def begin(self):
+        with self.lock:
+            self.active += 1
+            self.last_activity = time.monotonic()
+
+    def end(self):
+        with self.lock:
+            self.active -= 1
+            self.last_activity = time.monotonic()
+
+    def live_sessions(self):
+        live = False
+        try:
+            names = os.listdir(self.sessions)
+        except OSError:
+            return False
+        for name in names:
+            try:
+                os.kill(int(name), 0)
+                live = True
+            except PermissionError:
+                live = True
+            except (OSError, ValueError):
+                try:
+                    os.unlink(os.path.join(self.sessions, name))
+                except OSError:
+                    pass
+        return live
+
+    def idle(self):
+        with self.lock:
+            quiet = self.active == 0 and time.monotonic() - self.last_activity > IDLE_SECONDS
+        return quiet and not self.live_sessions()
+
+    def entry_path(self, url):
+        digest = hashlib.sha256(url.encode()).hexdigest()
+        return os.path.join(self.store, digest[:2], digest)
+
+
+def write_atomic(path, data):
+    fd, tmp = tempfile.mkstemp(dir=os.path.dirname(path), prefix=".tmp.")
+    try:
+        with os.fdopen(fd, "wb") as handle:
+            handle.write(data)
+        os.replace(tmp, path)
+    except BaseException:
+        try:
+            os.unlink(tmp)
+        except OSError:
+            pass
+        raise
+
+
+class Handler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    server_version = "cco-cache-proxy"
+    # Drop idle keep-alive connections so they don't hold the proxy open
+    timeout = 120
+    proxy = None
+
+    def log_message(self, format, *args):
+        pass
+
+    def handle_one_request(self):
+        self.proxy.begin()
+        try:
+            super().handle_one_request()
+        finally:
+            self.proxy.end()
+
+    def do_CONNECT(self):
+        host, _, port = self.path.rpartition(":")
+        try:
+            upstream = socket.create_connection((host, int(port)), timeout=UPSTREAM_TIMEOUT)
+        except (OSError, ValueError) as exc:
+            self.send_error(502, f"Cannot reach {self.path}: {exc}")
+            return
+        self.proxy.count(tunnels=1)
+        self.send_response(200, "Connection Established")
+        self.end_headers()
+        self.close_connection = True
+        relay(self.connection, upstream)
+
+    def do_GET(self):
+        self.forward()
+
+    def do_HEAD(self):
+        self.forward()
+
+    def do_POST(self):
+        self.forward()
+
+    def do_PUT(self):
+        self.forward()
+
+    def do_PATCH(self):
+        self.forward()
+
+    def do_DELETE(self):
+        self.forward()
+
+    def do_OPTIONS(self):
+        self.forward()
+
+    def target(self):
+        """(upstream URL, whether it came through the mirror route)"""
+        if self.path.startswith("http://"):
+            return self.path, False
+        if self.path.startswith("/https/"):
+            return "https://" + self.path[len("/https/"):], True
+        return None, False
+
+    def mirror_base(self):
+        return f"http://{self.headers.get('Host', '127.0.0.1')}/https/"
+
+    def forward(self):
+        url, mirrored = self.target()
+        if not url:
+            self.send_error(404, "Not a proxy request")
+            return
+        parts = urllib.parse.urlsplit(url)
+        cacheable = (
+            self.command == "GET"
+            and not self.headers.get("Authorization")
+            and not self.headers.get("Cookie")
+            and bool(ARTIFACT_RE.search(parts.path))
+        )
+        entry = self.proxy.entry_path(url) if cacheable else None
+        if entry and self.send_cached(entry):
+            return
+
+        headers = {}
+        for name, value in self.headers.items():
+            if name.lower() not in HOP_BY_HOP and name.lower() != "host":
+                headers[name] = value
+        rewrite = (
+            self.command == "GET" and mirrored and parts.hostname == "pypi.org" and parts.path.startswith("/simple")
+        )
+        if cacheable or rewrite:
+            headers["Accept-Encoding"] = "identity"
+        length = int(self.headers.get("Content-Length") or 0)
+        body = self.rfile.read(length) if length else None
+
+        try:
+            if parts.scheme == "https":
+                conn = http.client.HTTPSConnection(
+                    parts.hostname, parts.port, timeout=UPSTREAM_TIMEOUT, context=ssl.create_default_context()
+                )
+            else:
+                conn = http.client.HTTPConnection(parts.hostname, parts.port, timeout=UPSTREAM_TIMEOUT)
+            path = parts.path or "/"
+            if parts.query:
+                path += "?" + parts.query
+            conn.request(self.command, path, body=body, headers=headers)
+            resp = conn.getresponse()
+        except (OSError, http.client.HTTPException) as exc:
+            self.send_error(502, f"Upstream request failed: {exc}")
+            return
+
+        try:
+            store = (
+                entry is not None
+                and resp.status == 200
+                and not re.search(r"no-store|private", resp.getheader("Cache-Control", ""))
+                and not resp.getheader("Set-Cookie")
+            )
+            if store:
+                self.proxy.count(misses=1)
+                self.relay_and_store(resp, entry)
+            elif rewrite and resp.status == 200:
+                self.proxy.count(passthrough=1)
+                data = resp.read().replace(
+                    b"https://files.pythonhosted.org/", (self.mirror_base() + "files.pythonhosted.org/").encode()
+                )
+                self.send_upstream_headers(resp, extra={"Content-Length": str(len(data))})
+                self.wfile.write(data)
+                self.proxy.count(bytes_fetched=len(data))
+            else:
+                self.proxy.count(passthrough=1)
+                self.relay_response(resp, mirrored)
+        except OSError:
+            self.close_connection = True
+        finally:
+            conn.close()
+
+    def send_upstream_headers(self, resp, extra=None, mirrored=False):
+        skip = {"content-length"} if extra and "Content-Length" in extra else set()
+        self.send_response(resp.status, resp.reason)
+        for name, value in resp.getheaders():
+            lower = name.lower()
+            if lower in HOP_BY_HOP or lower in skip:
+                continue
+            if mirrored and lower == "location" and value.startswith("https://"):
+                value = self.mirror_base() + value[len("https://"):]
+            self.send_header(name, value)
+        for name, value in (extra or {}).items():
+            self.send_header(name, value)
+        self.send_header("Connection", "close")
+        self.end_headers()
+        self.close_connection = True
+
+    def relay_response(self, resp, mirrored):
+        self.send_upstream_headers(resp, mirrored=mirrored)
+        if self.command == "HEAD":
+            return
+        fetched = 0
+        while True:
+            chunk = resp.read(CHUNK)
+            if not chunk:
+                break
+            self.wfile.write(chunk)
+            fetched += len(chunk)
+        self.proxy.count(bytes_fetched=fetched)
+
+    def relay_and_store(self, resp, entry):
+        os.makedirs(os.path.dirname(entry), exist_ok=True)
+        fd, tmp = tempfile.mkstemp(dir=os.path.dirname(entry), prefix=".tmp.")
+        meta = {"type": resp.getheader("Content-Type", "application/octet-stream")}
+        expected = resp.getheader("Content-Length")
+        self.send_upstream_headers(resp, extra={"X-Cache": "MISS"})
+        fetched = 0
+        try:
+            with os.fdopen(fd, "wb") as handle:
+                while True:
+                    chunk = resp.read(CHUNK)
+                    if not chunk:
+                        break
+                    handle.write(chunk)
+                    fetched += len(chunk)
+                    self.wfile.write(chunk)
+            if expected is None or int(expected) == fetched:
+                write_atomic(entry + ".meta", json.dumps(meta).encode())
+                os.replace(tmp, entry)
+        finally:
+            if os.path.exists(tmp):
+                os.unlink(tmp)
+            self.proxy.count(bytes_fetched=fetched)
+
+    def send_cached(self, entry):
+        try:
+            with open(entry + ".meta", encoding="utf-8") as handle:
+                meta = json.load(handle)
+            data = open(entry, "rb")
+        except (OSError, ValueError):
+            return False
+        with data:
+            size = os.fstat(data.fileno()).st_size
+            self.send_response(200)
+            self.send_header("Content-Type", meta.get("type", "application/octet-stream"))
+            self.send_header("Content-Length", str(size))
+            self.send_header("X-Cache", "HIT")
+            self.end_headers()
+            while True:
+                chunk = data.read(CHUNK)
+                if not chunk:
+                    break
+                self.wfile.write(chunk)
+        self.proxy.count(hits=1, bytes_from_cache=size)
+        return True
+
+
+def relay(client, upstream):
+    sel = selectors.DefaultSelector()
+    sel.register(client, selectors.EVENT_READ, upstream)
+    sel.register(upstream, selectors.EVENT_READ, client)
+    client.settimeout(None)
+    upstream.settimeout(None)
+    try:
+        while True:
+            for key, _ in sel.select():
+                data = key.fileobj.recv(CHUNK)
+                if not data:
+                    return
+                key.data.sendall(data)
+    except OSError:
+        pass
+    finally:
+        sel.close()
+        upstream.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Caching HTTP proxy for cco sessions")
+    parser.add_argument("--root", required=True, help="state directory (port, pid, stats, store)")
+    args = parser.parse_args()
+
+    # Outlive the cco process that started it
+    try:
+        os.setsid()
+    except OSError:
+        pass
+
+    proxy = Proxy(args.root)
+    os.makedirs(proxy.store, exist_ok=True)
+    os.makedirs(proxy.sessions, exist_ok=True)
+    Handler.proxy = proxy
+    server = http.server.ThreadingHTTPServer(("127.0.0.1", 0), Handler)
+    server.daemon_threads = True
+
+    write_atomic(os.path.join(args.root, "pid"), f"{os.getpid()}\n".encode())
+    write_atomic(os.path.join(args.root, "port"), f"{server.server_address[1]}\n".encode())
+
+    def watch_idle():
+        while not proxy.idle():
+            time.sleep(5)
+        server.shutdown()
+
+    threading.Thread(target=watch_idle, daemon=True).start()
+    try:
+        server.serve_forever()
+    finally:
+        pid_file = os.path.join(args.root, "pid")
+        try:
+            with open(pid_file, encoding="utf-8") as handle:
+                ours = handle.read().strip() == str(os.getpid())
+            if ours:
+                os.unlink(os.path.join(args.root, "port"))
+                os.unlink(pid_file)
+        except OSError:
+            pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
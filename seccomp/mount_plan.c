@@ -0,0 +1,530 @@
+/*
+ * mount_plan.c - Compute sandbox's bwrap mount arguments in one pass
+ *
+ * Replaces the path-resolution and deny/allow nesting loops in sandbox's
+ * run_linux. Paths are resolved without a subshell each, and every
+ * allow path is matched against all deny paths with one walk of a
+ * component trie instead of a write_paths x deny_paths scan.
+ *
+ * Only needs a C compiler (cc/gcc/clang) and libc to build.
+ *
+ * Compile: cc -O2 -o mount_plan mount_plan.c
+ * Usage:   ./mount_plan [-s STORE] [-w PATH]... [-r PATH]... [-d PATH]...
+ *
+ * -w/-r/-d are sandbox's --write/--read-only/--deny paths, unresolved, in
+ * command-line order. With -s, deny overlays come from a content-addressed
+ * store shared by all launches instead of fresh temp files:
+ *
+ *   STORE/deny-dir-000, STORE/deny-file-000   plain deny overlays
+ *   STORE/deny-tree-<fnv1a64>                 overlay with exception mount
+ *                                             points, keyed on their
+ *                                             "d:" / "f:" relative paths
+ *
+ * Output records on stdout are NUL-terminated and start with a one-letter
+ * tag:
+ *
+ *   A<arg>    next bwrap argument
+ *   C<path>   temporary overlay to remove after bwrap exits
+ *   E         end of plan (missing if the helper failed part way)
+ *
+ * The plan is exactly what the bash implementation produces, including
+ * its side effects: missing allow targets are created as empty files and
+ * deny overlays are built under $TMPDIR (or STORE) with the same
+ * permissions.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+enum path_kind {
+    PATH_WRITE,
+    PATH_READ_ONLY,
+    PATH_DENY,
+};
+
+struct path_list {
+    char **paths;
+    int n;
+    int cap;
+};
+
+static void die(int status, const char *fmt, const char *arg) {
+    fprintf(stderr, "sandbox: ");
+    fprintf(stderr, fmt, arg);
+    fprintf(stderr, "\n");
+    exit(status);
+}
+
+static void *xrealloc(void *p, size_t size) {
+    p = realloc(p, size);
+    if (!p) {
+        die(1, "%s", "out of memory");
+    }
+    return p;
+}
+
+static char *xstrdup(const char *s) {
+    char *d = strdup(s);
+    if (!d) {
+        die(1, "%s", "out of memory");
+    }
+    return d;
+}
+
+static void list_push(struct path_list *l, char *path) {
+    if (l->n == l->cap) {
+        l->cap = l->cap ? l->cap * 2 : 16;
+        l->paths = xrealloc(l->paths, (size_t)l->cap * sizeof(char *));
+    }
+    l->paths[l->n++] = path;
+}
+
+/*
+ * =============================================================================
+ * PATH RESOLUTION (same rules as sandbox's abs_path)
+ * =============================================================================
+ *
+ * Expand ~, then return the absolute, symlink-free path. Directories are
+ * resolved completely; for files only the parent is resolved and the last
+ * component is kept. A missing path is fine as long as its parent exists.
+ */
+
+static int is_dir(const char *p) {
+    struct stat st;
+    return stat(p, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static int exists(const char *p) {
+    struct stat st;
+    return stat(p, &st) == 0;
+}
+
+static int is_file(const char *p) {
+    struct stat st;
+    return stat(p, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+/* Split into dirname/basename the way dirname(1)/basename(1) do */
+static void split_path(const char *p, char *parent, char *base) {
+    char tmp[PATH_MAX];
+    char *slash;
+    size_t len;
+
+    snprintf(tmp, sizeof(tmp), "%s", p);
+    len = strlen(tmp);
+    while (len > 1 && tmp[len - 1] == '/') {
+        tmp[--len] = '\0';
+    }
+    slash = strrchr(tmp, '/');
+    if (!slash) {
+        strcpy(parent, ".");
+        strcpy(base, tmp);
+    } else if (slash == tmp) {
+        strcpy(parent, "/");
+        strcpy(base, tmp[1] ? tmp + 1 : "/");
+    } else {
+        strcpy(base, slash + 1);
+        while (slash > tmp && slash[-1] == '/') {
+            slash--;
+        }
+        *slash = '\0';
+        strcpy(parent, tmp);
+    }
+}
+
+static char *resolve_path(const char *arg) {
+    char p[PATH_MAX], parent[PATH_MAX], base[PATH_MAX], real[PATH_MAX], out[PATH_MAX * 2];
+    const char *home = getenv("HOME");
+
+    if ((strcmp(arg, "~") == 0 || strncmp(arg, "~/", 2) == 0) && home) {
+        snprintf(p, sizeof(p), "%s%s", home, arg + 1);
+    } else {
+        snprintf(p, sizeof(p), "%s", arg);
+    }
+
+    if (is_dir(p)) {
+        if (!realpath(p, real)) {
+            die(2, "cannot resolve path: %s", p);
+        }
+        return xstrdup(real);
+    }
+    split_path(p, parent, base);
+    if (!exists(p) && !is_dir(parent)) {
+        die(2, "parent directory does not exist: %s", parent);
+    }
+    if (!realpath(parent, real)) {
+        die(2, "cannot resolve path: %s", parent);
+    }
+    snprintf(out, sizeof(out), "%s/%s", strcmp(real, "/") == 0 ? "" : real, base);
+    return xstrdup(out);
+}
+
+/*
+ * =============================================================================
+ * DENY TRIE
+ * =============================================================================
+ *
+ * One node per path component, children kept sorted by name. A node that
+ * ends a deny path carries that deny's index (and any duplicates chained
+ * through deny_next), so walking an allow path visits every deny it is
+ * under, i.e. every deny D with path == D or path under D/.
+ */
+
+struct trie_node {
+    char *name;
+    struct trie_node *child;
+    struct trie_node *next;
+    int deny;  /* first deny index ending here, or -1 */
+};
+
+static struct trie_node *trie_child(struct trie_node *node, const char *name, size_t len, int create) {
+    struct trie_node **link = &node->child;
+    struct trie_node *n;
+    int cmp;
+
+    for (; *link; link = &(*link)->next) {
+        cmp = strncmp((*link)->name, name, len);
+        if (cmp == 0 && (*link)->name[len] == '\0') {
+            return *link;
+        }
+        if (cmp > 0 || (cmp == 0 && (*link)->name[len] != '\0')) {
+            break;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    n = xrealloc(NULL, sizeof(*n));
+    n->name = xrealloc(NULL, len + 1);
+    memcpy(n->name, name, len);
+    n->name[len] = '\0';
+    n->child = NULL;
+    n->deny = -1;
+    n->next = *link;
+    *link = n;
+    return n;
+}
+
+/* Next path component after *p; returns its length, 0 at the end */
+static size_t next_component(const char **p) {
+    size_t len;
+    while (**p == '/') {
+        (*p)++;
+    }
+    len = strcspn(*p, "/");
+    return len;
+}
+
+static void trie_insert(struct trie_node *root, const char *path, int index, int *deny_next) {
+    struct trie_node *node = root;
+    const char *p = path;
+    size_t len;
+    int *tail;
+
+    while ((len = next_component(&p)) > 0) {
+        node = trie_child(node, p, len, 1);
+        p += len;
+    }
+    for (tail = &node->deny; *tail >= 0; tail = &deny_next[*tail]) {
+    }
+    *tail = index;
+}
+
+/*
+ * =============================================================================
+ * PLAN OUTPUT
+ * =============================================================================
+ */
+
+static void emit(char tag, const char *value) {
+    putchar(tag);
+    fputs(value, stdout);
+    putchar('\0');
+}
+
+static void emit_bind(const char *flag, const char *src, const char *dst) {
+    emit('A', flag);
+    emit('A', src);
+    emit('A', dst);
+}
+
+static void touch(const char *path) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        die(1, "cannot create mount target: %s", path);
+    }
+    close(fd);
+}
+
+static const char *store;  /* -s STORE, or NULL */
+
+static const char *tmp_template(void) {
+    static char buf[PATH_MAX];
+    const char *dir = store ? store : getenv("TMPDIR");
+    snprintf(buf, sizeof(buf), "%s/tmp.XXXXXX", dir && *dir ? dir : "/tmp");
+    return buf;
+}
+
+/* make_deny_dir / make_deny_file 000 from sandbox, shared in the store */
+static char *store_deny(int dir) {
+    char path[PATH_MAX];
+    int fd;
+
+    snprintf(path, sizeof(path), "%s/%s", store, dir ? "deny-dir-000" : "deny-file-000");
+    if (!exists(path)) {
+        if (dir) {
+            if (mkdir(path, 0) != 0 && errno != EEXIST) {
+                die(1, "cannot create overlay: %s", path);
+            }
+        } else {
+            fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0);
+            if (fd < 0 && errno != EEXIST) {
+                die(1, "cannot create overlay: %s", path);
+            }
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+        chmod(path, 0);
+    }
+    return xstrdup(path);
+}
+
+/* FNV-1a, 64-bit; sandbox's bash fallback computes the same key */
+static unsigned long long fnv1a64(unsigned long long h, const char *s) {
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/* make_deny_dir / make_deny_file from sandbox */
+static char *make_deny(int dir, mode_t mode) {
+    char *path;
+    int fd;
+
+    if (store && mode == 0) {
+        return store_deny(dir);
+    }
+    path = xstrdup(tmp_template());
+
+    if (dir) {
+        if (!mkdtemp(path)) {
+            die(1, "mktemp failed: %s", strerror(errno));
+        }
+    } else {
+        fd = mkstemp(path);
+        if (fd < 0) {
+            die(1, "mktemp failed: %s", strerror(errno));
+        }
+        close(fd);
+    }
+    if (chmod(path, mode) != 0) {
+        die(1, "chmod failed: %s", path);
+    }
+    emit('C', path);
+    return path;
+}
+
+static void mkdir_one(const char *path, struct path_list *dirs) {
+    if (!is_dir(path) && mkdir(path, 0777) != 0 && errno != EEXIST) {
+        die(1, "cannot create overlay directory: %s", path);
+    }
+    list_push(dirs, xstrdup(path));
+}
+
+/* create_deny_overlay_target from sandbox */
+static void create_overlay_target(const char *overlay, const char *deny, const char *target,
+                                  struct path_list *dirs, struct path_list *files) {
+    char path[PATH_MAX * 2];
+    const char *rel, *p;
+    size_t len, base;
+    int target_is_dir = is_dir(target);
+
+    if (strcmp(target, deny) == 0) {
+        return;
+    }
+    rel = target + strlen(deny) + 1;
+    base = (size_t)snprintf(path, sizeof(path), "%s", overlay);
+    for (p = rel; *p; p += len) {
+        len = next_component(&p);
+        if (len == 0) {
+            break;
+        }
+        if (!target_is_dir && p[len] == '\0') {
+            break;  /* last component of a file */
+        }
+        base += (size_t)snprintf(path + base, sizeof(path) - base, "/%.*s", (int)len, p);
+        mkdir_one(path, dirs);
+    }
+    if (!target_is_dir) {
+        snprintf(path, sizeof(path), "%s/%s", overlay, rel);
+        touch(path);
+        list_push(files, xstrdup(path));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    struct path_list lists[3] = { { 0 } };
+    struct trie_node root = { 0 };
+    struct path_list *denies = &lists[PATH_DENY];
+    struct path_list *under;       /* per deny: allow paths under it, write then ro */
+    int *deny_next, *has_exceptions, *under_deny[2];
+    const char *debug = getenv("CCO_DEBUG");
+    int i, j, k, d;
+
+    for (i = 1; i < argc; i++) {
+        enum path_kind kind;
+        if (strcmp(argv[i], "-w") == 0) {
+            kind = PATH_WRITE;
+        } else if (strcmp(argv[i], "-r") == 0) {
+            kind = PATH_READ_ONLY;
+        } else if (strcmp(argv[i], "-d") == 0) {
+            kind = PATH_DENY;
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            store = argv[++i];
+            continue;
+        } else {
+            fprintf(stderr, "Usage: %s [-s STORE] [-w PATH]... [-r PATH]... [-d PATH]...\n", argv[0]);
+            return 1;
+        }
+        if (++i >= argc) {
+            fprintf(stderr, "Usage: %s [-s STORE] [-w PATH]... [-r PATH]... [-d PATH]...\n", argv[0]);
+            return 1;
+        }
+        list_push(&lists[kind], resolve_path(argv[i]));
+    }
+
+    deny_next = xrealloc(NULL, (size_t)(denies->n + 1) * sizeof(int));
+    has_exceptions = xrealloc(NULL, (size_t)(denies->n + 1) * sizeof(int));
+    under = xrealloc(NULL, (size_t)(denies->n + 1) * sizeof(struct path_list) * 2);
+    memset(under, 0, (size_t)(denies->n + 1) * sizeof(struct path_list) * 2);
+    root.deny = -1;
+    for (d = 0; d < denies->n; d++) {
+        deny_next[d] = -1;
+        has_exceptions[d] = 0;
+        trie_insert(&root, denies->paths[d], d, deny_next);
+    }
+
+    /* Walk every allow path once, collecting the denies it falls under */
+    for (k = 0; k < 2; k++) {
+        under_deny[k] = xrealloc(NULL, (size_t)(lists[k].n + 1) * sizeof(int));
+        for (i = 0; i < lists[k].n; i++) {
+            struct trie_node *node = &root;
+            const char *p = lists[k].paths[i];
+            size_t len;
+
+            under_deny[k][i] = 0;
+            while (node && (len = next_component(&p)) > 0) {
+                node = trie_child(node, p, len, 0);
+                p += len;
+                for (d = node ? node->deny : -1; d >= 0; d = deny_next[d]) {
+                    under_deny[k][i] = 1;
+                    has_exceptions[d] = 1;
+                    list_push(&under[2 * d + k], lists[k].paths[i]);
+                }
+            }
+        }
+    }
+
+    if (debug && strcmp(debug, "1") == 0) {
+        for (d = 0; d < denies->n; d++) {
+            if (has_exceptions[d]) {
+                fprintf(stderr, "DEBUG: Deny path with exceptions: %s\n", denies->paths[d]);
+            }
+        }
+    }
+
+    /* Write and read-only paths that are not under any deny path */
+    for (k = 0; k < 2; k++) {
+        for (i = 0; i < lists[k].n; i++) {
+            if (under_deny[k][i]) {
+                continue;
+            }
+            if (!exists(lists[k].paths[i])) {
+                touch(lists[k].paths[i]);
+            }
+            emit_bind(k == PATH_WRITE ? "--bind" : "--ro-bind", lists[k].paths[i], lists[k].paths[i]);
+        }
+    }
+
+    /* Deny paths, each followed by the exceptions mounted on top */
+    for (d = 0; d < denies->n; d++) {
+        const char *ap = denies->paths[d];
+        char *overlay;
+
+        if (!has_exceptions[d]) {
+            overlay = make_deny(!is_file(ap), 0);
+            emit_bind("--ro-bind", overlay, ap);
+            continue;
+        }
+        if (is_dir(ap)) {
+            struct path_list dirs = { 0 }, files = { 0 };
+            char final[PATH_MAX];
+
+            final[0] = '\0';
+            if (store) {
+                /* The overlay only depends on the exception mount points */
+                unsigned long long h = 14695981039346656037ULL;
+                size_t root_len = strlen(ap);
+                for (k = 0; k < 2; k++) {
+                    for (j = 0; j < under[2 * d + k].n; j++) {
+                        const char *p = under[2 * d + k].paths[j];
+                        if (strcmp(p, ap) == 0) {
+                            continue;
+                        }
+                        h = fnv1a64(h, is_dir(p) ? "d:" : "f:");
+                        h = fnv1a64(h, p + root_len + 1);
+                        h = fnv1a64(h, "\n");
+                    }
+                }
+                snprintf(final, sizeof(final), "%s/deny-tree-%016llx", store, h);
+                if (is_dir(final)) {
+                    emit_bind("--ro-bind", final, ap);
+                    goto exceptions;
+                }
+            }
+            overlay = make_deny(1, 0755);
+            for (k = 0; k < 2; k++) {
+                for (j = 0; j < under[2 * d + k].n; j++) {
+                    create_overlay_target(overlay, ap, under[2 * d + k].paths[j], &dirs, &files);
+                }
+            }
+            for (j = 0; j < dirs.n; j++) {
+                chmod(dirs.paths[j], 0111);
+            }
+            for (j = 0; j < files.n; j++) {
+                chmod(files.paths[j], 0);
+            }
+            /* Publish atomically; a concurrent launch may have won the race */
+            if (final[0] && (rename(overlay, final) == 0 || is_dir(final))) {
+                overlay = xstrdup(final);
+            }
+            chmod(overlay, 0111);
+        } else {
+            overlay = make_deny(0, 0);
+        }
+        emit_bind("--ro-bind", overlay, ap);
+    exceptions:
+        for (k = 0; k < 2; k++) {
+            for (j = 0; j < under[2 * d + k].n; j++) {
+                const char *p = under[2 * d + k].paths[j];
+                if (!exists(p)) {
+                    touch(p);
+                }
+                emit_bind(k == PATH_WRITE ? "--bind" : "--ro-bind", p, p);
+            }
+        }
+    }
+
+    putchar('E');
+    putchar('\0');
+    return fflush(stdout) == 0 ? 0 : 1;
+}
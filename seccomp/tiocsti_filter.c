@@ -5,9 +5,21 @@
  * Only needs a C compiler (cc/gcc/clang) to build.
  *
  * Compile: cc -O2 -o tiocsti_filter tiocsti_filter.c
- * Usage:   ./tiocsti_filter /path/to/output.bpf
+ * Usage:   ./tiocsti_filter [--arch NAME] [--policy FILE] [--hot LIST] /path/to/output.bpf
+ *          ./tiocsti_filter --bundle [--policy FILE] /path/to/tiocsti_filter.bundle
+ *          ./tiocsti_filter --verify FILE [--arch NAME] [--policy FILE] [--fuzz N]
+ *          ./tiocsti_filter --supervise LOG [--policy FILE] [--notify LIST] -- command...
+ *          ./tiocsti_filter --launch PLAN /path/to/sandbox [options] command...
  *          bwrap --seccomp 3 3</path/to/output.bpf ...
  *
+ * Without --policy the built-in default policy is compiled (block TIOCSTI
+ * and TIOCLINUX). With --policy, rules are read from FILE (see "POLICY
+ * FILES" below) and compiled into a balanced binary-search tree over
+ * syscall numbers, so the per-syscall instruction count grows with
+ * log2(rules) instead of linearly. A "hot set" of high-traffic syscalls
+ * (read, write, futex, ...) is range-checked and allowed before anything
+ * else, and a per-syscall instruction count report is printed.
+ *
  * Security considerations addressed:
  * - 32-bit ioctl cmd masking (prevents high-bit bypass CVE-2019-10063)
  * - x32 ABI rejection on x86_64 (syscall number offset 0x40000000)
@@ -15,11 +27,16 @@
  * - Architecture validation (prevents syscall confusion attacks)
  */
 
+#ifdef __linux__
+#define _GNU_SOURCE  /* syscall() and process_vm_readv() for --supervise */
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
 
 /*
  * =============================================================================
@@ -31,6 +48,7 @@
 /* Seccomp return values (from linux/seccomp.h) */
 #define SECCOMP_RET_KILL_PROCESS 0x80000000U
 #define SECCOMP_RET_ERRNO        0x00050000U
+#define SECCOMP_RET_USER_NOTIF   0x7fc00000U
 #define SECCOMP_RET_ALLOW        0x7fff0000U
 #define SECCOMP_RET_DATA         0x0000ffffU
 
@@ -40,7 +58,10 @@
 #define BPF_RET  0x06
 #define BPF_W    0x00
 #define BPF_ABS  0x20
+#define BPF_JA   0x00
 #define BPF_JEQ  0x10
+#define BPF_JGT  0x20
+#define BPF_JGE  0x30
 #define BPF_JSET 0x40
 #define BPF_K    0x00
 
@@ -50,12 +71,9 @@
 #define AUDIT_ARCH_AARCH64  0xc00000b7U  /* EM_AARCH64 | 64BIT | LE */
 #define AUDIT_ARCH_I386     0x40000003U  /* EM_386 | LE */
 #define AUDIT_ARCH_ARM      0x40000028U  /* EM_ARM | LE */
-
-/* Syscall numbers - architecture specific */
-#define __NR_ioctl_x86_64   16
-#define __NR_ioctl_aarch64  29
-#define __NR_ioctl_i386     54
-#define __NR_ioctl_arm      54
+#define AUDIT_ARCH_RISCV64  0xc00000f3U  /* EM_RISCV | 64BIT | LE */
+#define AUDIT_ARCH_PPC64LE  0xc0000015U  /* EM_PPC64 | 64BIT | LE */
+#define AUDIT_ARCH_S390X    0x80000016U  /* EM_S390 | 64BIT (big-endian) */
 
 /* x32 ABI syscall bit (x86_64 only) */
 #define X32_SYSCALL_BIT     0x40000000U
@@ -63,6 +81,8 @@
 /* Dangerous ioctls to block */
 #define TIOCSTI   0x5412  /* Inject char into terminal input - sandbox escape */
 #define TIOCLINUX 0x541c  /* Virtual console input injection - CVE-2023-1523 */
+#define TIOCCONS  0x541d  /* Redirect console output to this tty */
+#define TIOCSETD  0x5423  /* Set line discipline - loads tty ldisc modules */
 
 /*
  * struct sock_filter - BPF instruction (from linux/filter.h)
@@ -86,11 +106,13 @@ struct sock_filter {
  * };
  *
  * args[1] is at offset 24 (ioctl cmd argument)
- * We load only the low 32 bits to handle 64-bit bypass attempts
+ * We load only the low 32 bits to handle 64-bit bypass attempts; on
+ * big-endian targets they are the second word of each argument.
  */
 #define OFF_NR       0
 #define OFF_ARCH     4
-#define OFF_ARG1_LO  24  /* Low 32 bits of args[1] on little-endian */
+#define OFF_ARGS     16
+#define OFF_ARG_LO(arch, n) (OFF_ARGS + 8 * (n) + ((arch)->big_endian ? 4 : 0))
 
 /* BPF instruction macros */
 #define BPF_STMT(code, k) \
@@ -102,180 +124,2485 @@ struct sock_filter {
 /* Return value helpers */
 #define RET_ALLOW       SECCOMP_RET_ALLOW
 #define RET_KILL        SECCOMP_RET_KILL_PROCESS
+#define RET_NOTIFY      SECCOMP_RET_USER_NOTIF
 #define RET_ERRNO(e)    (SECCOMP_RET_ERRNO | ((e) & SECCOMP_RET_DATA))
 
 /*
- * Detect architecture at compile time
+ * =============================================================================
+ * ARCHITECTURE AND SYSCALL TABLES
+ * =============================================================================
+ *
+ * Only syscalls that policies are expected to reference are listed. Policy
+ * files may also name a syscall by number for anything missing here.
+ */
+
+struct syscall_nr {
+    const char *name;
+    int nr;
+};
+
+static const struct syscall_nr syscalls_x86_64[] = {
+    { "read", 0 }, { "write", 1 }, { "open", 2 }, { "close", 3 },
+    { "fstat", 5 }, { "poll", 7 }, { "lseek", 8 }, { "mmap", 9 },
+    { "munmap", 11 }, { "brk", 12 }, { "ioctl", 16 }, { "pread64", 17 },
+    { "pwrite64", 18 }, { "readv", 19 }, { "writev", 20 },
+    { "sched_yield", 24 }, { "nanosleep", 35 }, { "getpid", 39 },
+    { "connect", 42 }, { "execve", 59 }, { "ptrace", 101 }, { "mount", 165 },
+    { "futex", 202 }, { "clock_gettime", 228 }, { "exit_group", 231 },
+    { "epoll_wait", 232 }, { "add_key", 248 }, { "request_key", 249 },
+    { "keyctl", 250 }, { "openat", 257 }, { "newfstatat", 262 },
+    { "unshare", 272 }, { "epoll_pwait", 281 }, { "perf_event_open", 298 },
+    { "setns", 308 }, { "seccomp", 317 }, { "getrandom", 318 },
+    { "bpf", 321 }, { "execveat", 322 }, { "userfaultfd", 323 },
+};
+
+static const struct syscall_nr syscalls_aarch64[] = {
+    { "epoll_pwait", 22 }, { "ioctl", 29 }, { "mount", 40 }, { "openat", 56 },
+    { "close", 57 }, { "lseek", 62 }, { "read", 63 }, { "write", 64 },
+    { "readv", 65 }, { "writev", 66 }, { "pread64", 67 }, { "pwrite64", 68 },
+    { "ppoll", 73 }, { "newfstatat", 79 }, { "fstat", 80 },
+    { "exit_group", 94 }, { "unshare", 97 }, { "futex", 98 },
+    { "nanosleep", 101 }, { "clock_gettime", 113 }, { "ptrace", 117 },
+    { "sched_yield", 124 }, { "getpid", 172 }, { "connect", 203 },
+    { "brk", 214 }, { "munmap", 215 }, { "add_key", 217 },
+    { "request_key", 218 }, { "keyctl", 219 }, { "execve", 221 },
+    { "mmap", 222 }, { "perf_event_open", 241 }, { "setns", 268 },
+    { "seccomp", 277 }, { "getrandom", 278 }, { "bpf", 280 },
+    { "execveat", 281 }, { "userfaultfd", 282 },
+};
+
+static const struct syscall_nr syscalls_i386[] = {
+    { "read", 3 }, { "write", 4 }, { "open", 5 }, { "close", 6 },
+    { "execve", 11 }, { "lseek", 19 }, { "getpid", 20 }, { "mount", 21 },
+    { "ptrace", 26 }, { "brk", 45 }, { "ioctl", 54 }, { "munmap", 91 },
+    { "readv", 145 }, { "writev", 146 }, { "sched_yield", 158 },
+    { "nanosleep", 162 }, { "poll", 168 }, { "pread64", 180 },
+    { "pwrite64", 181 }, { "mmap2", 192 }, { "fstat64", 197 },
+    { "futex", 240 }, { "exit_group", 252 }, { "epoll_wait", 256 },
+    { "clock_gettime", 265 }, { "add_key", 286 }, { "request_key", 287 },
+    { "keyctl", 288 }, { "openat", 295 }, { "unshare", 310 },
+    { "epoll_pwait", 319 }, { "perf_event_open", 336 }, { "setns", 346 },
+    { "seccomp", 354 }, { "getrandom", 355 }, { "bpf", 357 },
+    { "execveat", 358 }, { "connect", 362 }, { "userfaultfd", 374 },
+};
+
+static const struct syscall_nr syscalls_arm[] = {
+    { "read", 3 }, { "write", 4 }, { "open", 5 }, { "close", 6 },
+    { "execve", 11 }, { "lseek", 19 }, { "getpid", 20 }, { "mount", 21 },
+    { "ptrace", 26 }, { "brk", 45 }, { "ioctl", 54 }, { "munmap", 91 },
+    { "readv", 145 }, { "writev", 146 }, { "sched_yield", 158 },
+    { "nanosleep", 162 }, { "poll", 168 }, { "pread64", 180 },
+    { "pwrite64", 181 }, { "mmap2", 192 }, { "fstat64", 197 },
+    { "futex", 240 }, { "exit_group", 248 }, { "epoll_wait", 252 },
+    { "clock_gettime", 263 }, { "connect", 283 }, { "add_key", 309 },
+    { "request_key", 310 }, { "keyctl", 311 }, { "openat", 322 },
+    { "unshare", 337 }, { "epoll_pwait", 346 }, { "perf_event_open", 364 },
+    { "setns", 375 }, { "seccomp", 383 }, { "getrandom", 384 },
+    { "bpf", 386 }, { "execveat", 387 }, { "userfaultfd", 388 },
+};
+
+static const struct syscall_nr syscalls_ppc64le[] = {
+    { "read", 3 }, { "write", 4 }, { "open", 5 }, { "close", 6 },
+    { "execve", 11 }, { "lseek", 19 }, { "getpid", 20 }, { "mount", 21 },
+    { "ptrace", 26 }, { "brk", 45 }, { "ioctl", 54 }, { "mmap", 90 },
+    { "munmap", 91 }, { "fstat", 108 }, { "readv", 145 }, { "writev", 146 },
+    { "sched_yield", 158 }, { "nanosleep", 162 }, { "poll", 167 },
+    { "pread64", 179 }, { "pwrite64", 180 }, { "futex", 221 },
+    { "exit_group", 234 }, { "epoll_wait", 238 }, { "clock_gettime", 246 },
+    { "add_key", 269 }, { "request_key", 270 }, { "keyctl", 271 },
+    { "ppoll", 281 }, { "unshare", 282 }, { "openat", 286 },
+    { "newfstatat", 291 }, { "epoll_pwait", 303 }, { "perf_event_open", 319 },
+    { "connect", 328 }, { "setns", 350 }, { "seccomp", 358 },
+    { "getrandom", 359 }, { "bpf", 361 }, { "execveat", 362 },
+    { "userfaultfd", 364 },
+};
+
+static const struct syscall_nr syscalls_s390x[] = {
+    { "read", 3 }, { "write", 4 }, { "open", 5 }, { "close", 6 },
+    { "execve", 11 }, { "lseek", 19 }, { "getpid", 20 }, { "mount", 21 },
+    { "ptrace", 26 }, { "brk", 45 }, { "ioctl", 54 }, { "mmap", 90 },
+    { "munmap", 91 }, { "fstat", 108 }, { "readv", 145 }, { "writev", 146 },
+    { "sched_yield", 158 }, { "nanosleep", 162 }, { "poll", 168 },
+    { "pread64", 180 }, { "pwrite64", 181 }, { "futex", 238 },
+    { "exit_group", 248 }, { "epoll_wait", 251 }, { "clock_gettime", 260 },
+    { "add_key", 278 }, { "request_key", 279 }, { "keyctl", 280 },
+    { "openat", 288 }, { "newfstatat", 293 }, { "ppoll", 302 },
+    { "unshare", 303 }, { "epoll_pwait", 312 }, { "perf_event_open", 331 },
+    { "setns", 339 }, { "seccomp", 348 }, { "getrandom", 349 },
+    { "bpf", 351 }, { "execveat", 354 }, { "userfaultfd", 355 },
+    { "connect", 362 },
+};
+
+#define TABLE_LEN(t) (sizeof(t) / sizeof((t)[0]))
+
+struct arch_info {
+    const char *name;
+    uint32_t audit_arch;
+    int has_x32_abi;
+    int big_endian;
+    const struct syscall_nr *syscalls;
+    size_t n_syscalls;
+};
+
+/* riscv64 uses the asm-generic syscall table, same as aarch64 */
+static const struct arch_info arches[] = {
+    { "x86_64",  AUDIT_ARCH_X86_64,  1, 0, syscalls_x86_64,  TABLE_LEN(syscalls_x86_64) },
+    { "aarch64", AUDIT_ARCH_AARCH64, 0, 0, syscalls_aarch64, TABLE_LEN(syscalls_aarch64) },
+    { "i386",    AUDIT_ARCH_I386,    0, 0, syscalls_i386,    TABLE_LEN(syscalls_i386) },
+    { "arm",     AUDIT_ARCH_ARM,     0, 0, syscalls_arm,     TABLE_LEN(syscalls_arm) },
+    { "riscv64", AUDIT_ARCH_RISCV64, 0, 0, syscalls_aarch64, TABLE_LEN(syscalls_aarch64) },
+    { "ppc64le", AUDIT_ARCH_PPC64LE, 0, 0, syscalls_ppc64le, TABLE_LEN(syscalls_ppc64le) },
+    { "s390x",   AUDIT_ARCH_S390X,   0, 1, syscalls_s390x,   TABLE_LEN(syscalls_s390x) },
+};
+
+/*
+ * Detect the default target architecture at compile time.
+ * Any architecture in the table above can be selected with --arch.
  */
 #if defined(__x86_64__)
-    #define CURRENT_ARCH    AUDIT_ARCH_X86_64
-    #define CURRENT_IOCTL   __NR_ioctl_x86_64
-    #define ARCH_NAME       "x86_64"
-    #define HAS_X32_ABI     1
+    #define HOST_ARCH_NAME  "x86_64"
 #elif defined(__aarch64__)
-    #define CURRENT_ARCH    AUDIT_ARCH_AARCH64
-    #define CURRENT_IOCTL   __NR_ioctl_aarch64
-    #define ARCH_NAME       "aarch64"
-    #define HAS_X32_ABI     0
+    #define HOST_ARCH_NAME  "aarch64"
 #elif defined(__i386__)
-    #define CURRENT_ARCH    AUDIT_ARCH_I386
-    #define CURRENT_IOCTL   __NR_ioctl_i386
-    #define ARCH_NAME       "i386"
-    #define HAS_X32_ABI     0
+    #define HOST_ARCH_NAME  "i386"
 #elif defined(__arm__)
-    #define CURRENT_ARCH    AUDIT_ARCH_ARM
-    #define CURRENT_IOCTL   __NR_ioctl_arm
-    #define ARCH_NAME       "arm"
-    #define HAS_X32_ABI     0
+    #define HOST_ARCH_NAME  "arm"
+#elif defined(__riscv) && __riscv_xlen == 64
+    #define HOST_ARCH_NAME  "riscv64"
+#elif defined(__powerpc64__) && defined(__LITTLE_ENDIAN__)
+    #define HOST_ARCH_NAME  "ppc64le"
+#elif defined(__s390x__)
+    #define HOST_ARCH_NAME  "s390x"
 #else
-    #error "Unsupported architecture. Supported: x86_64, aarch64, i386, arm"
+    #define HOST_ARCH_NAME  NULL
 #endif
 
+static const struct arch_info *find_arch(const char *name) {
+    size_t i;
+    if (!name) {
+        return NULL;
+    }
+    for (i = 0; i < TABLE_LEN(arches); i++) {
+        if (strcmp(arches[i].name, name) == 0) {
+            return &arches[i];
+        }
+    }
+    return NULL;
+}
+
+static int lookup_syscall(const struct arch_info *arch, const char *name) {
+    size_t i;
+    char *end;
+    long nr;
+
+    for (i = 0; i < arch->n_syscalls; i++) {
+        if (strcmp(arch->syscalls[i].name, name) == 0) {
+            return arch->syscalls[i].nr;
+        }
+    }
+    /* Allow raw syscall numbers for anything not in the table */
+    nr = strtol(name, &end, 0);
+    if (*name && *end == '\0' && nr >= 0 && nr < (long)X32_SYSCALL_BIT) {
+        return (int)nr;
+    }
+    return -1;
+}
+
+/* Highest syscall number in the arch table; reports scan 0..this */
+static uint32_t arch_max_nr(const struct arch_info *arch) {
+    uint32_t max = 0;
+    size_t i;
+    for (i = 0; i < arch->n_syscalls; i++) {
+        if ((uint32_t)arch->syscalls[i].nr > max) {
+            max = (uint32_t)arch->syscalls[i].nr;
+        }
+    }
+    return max;
+}
+
+static const char *syscall_name(const struct arch_info *arch, int nr) {
+    size_t i;
+    for (i = 0; i < arch->n_syscalls; i++) {
+        if (arch->syscalls[i].nr == nr) {
+            return arch->syscalls[i].name;
+        }
+    }
+    return "?";
+}
+
 /*
  * =============================================================================
- * BPF FILTER PROGRAM
+ * POLICY FILES
  * =============================================================================
  *
- * Logic flow:
- * 1. Load and validate architecture
- * 2. [x86_64 only] Reject x32 ABI syscalls
- * 3. Check if syscall is ioctl
- * 4. If ioctl, load cmd argument (low 32 bits only!)
- * 5. Block TIOCSTI (0x5412) and TIOCLINUX (0x541c)
- * 6. Allow everything else
+ * One rule per line, '#' starts a comment:
+ *
+ *   <action> <syscall> [arg<N> <value> [<value>...]]
+ *
+ *   action   errno (EPERM), errno:<num>, kill, allow, notify
+ *   syscall  name from the arch table above, or a raw number
+ *   value    number (C syntax) or a named ioctl (TIOCSTI, TIOCLINUX, ...)
+ *
+ * A rule without an argument match applies to every call of that syscall.
+ * A rule with arg<N> applies only when the low 32 bits of args[N] equal
+ * one of the values; different values of the same argument can carry
+ * different actions. Each syscall may match on at most one argument.
+ * Anything not matched by a rule is allowed.
+ *
+ * Argument values are compared on their low 32 bits only, the same way the
+ * kernel truncates an ioctl cmd to unsigned int (CVE-2019-10063).
+ *
+ * "notify" rules are audited, not blocked: they are left out of the
+ * bwrap filter and compiled only by --supervise (see SUPERVISOR below).
+ *
+ *   hot <syscall> [<syscall>...]
+ *
+ * "hot" lists the syscalls that dominate traffic, most frequent first.
+ * They are range-checked and allowed right after the syscall number is
+ * loaded, ahead of the x32 check and the rule tree. Names missing on the
+ * target arch are skipped so one policy serves every architecture. Without
+ * a hot line (or --hot) the built-in hot set is used.
+ */
+
+#define MAX_RULES      256
+#define MAX_ARG_VALUES 64
+#define ARG_NONE       (-1)
+#define MAX_HOT        32
+
+struct arg_match {
+    uint32_t value;
+    uint32_t action;
+};
+
+struct rule {
+    int nr;
+    int arg;              /* ARG_NONE for unconditional rules */
+    uint32_t action;      /* used when arg == ARG_NONE */
+    struct arg_match values[MAX_ARG_VALUES];
+    int n_values;
+};
+
+struct nr_range {
+    uint32_t lo;
+    uint32_t hi;
+};
+
+struct policy {
+    struct rule rules[MAX_RULES];
+    int n_rules;
+    int hot[MAX_HOT];                     /* syscall numbers, most frequent first */
+    int n_hot;
+    int hot_given;                        /* hot line or --hot replaced the default */
+    struct nr_range hot_ranges[MAX_HOT];  /* chosen by compile_policy() */
+    int n_hot_ranges;
+};
+
+struct named_value {
+    const char *name;
+    uint32_t value;
+};
+
+static const struct named_value named_values[] = {
+    { "TIOCSTI", TIOCSTI },
+    { "TIOCLINUX", TIOCLINUX },
+    { "TIOCCONS", TIOCCONS },
+    { "TIOCSETD", TIOCSETD },
+};
+
+/* Built-in policy used when no --policy file is given */
+static const char *default_policy[] = {
+    "errno ioctl arg1 TIOCSTI TIOCLINUX",
+};
+
+/* Built-in notify set for --supervise when the policy has no notify rules */
+static const char *default_notify_set = "connect,execve,execveat";
+
+/* Built-in hot set: what a busy agent session spends its syscalls on */
+static const char *default_hot_set =
+    "read,write,futex,epoll_wait,epoll_pwait,readv,writev,pread64,pwrite64,close";
+
+static int parse_action(const char *s, uint32_t *action) {
+    char *end;
+    long e;
+
+    if (strcmp(s, "errno") == 0) {
+        *action = RET_ERRNO(EPERM);
+    } else if (strncmp(s, "errno:", 6) == 0) {
+        e = strtol(s + 6, &end, 0);
+        if (s[6] == '\0' || *end != '\0' || e < 0 || e > (long)SECCOMP_RET_DATA) {
+            return -1;
+        }
+        *action = RET_ERRNO((uint32_t)e);
+    } else if (strcmp(s, "kill") == 0) {
+        *action = RET_KILL;
+    } else if (strcmp(s, "allow") == 0) {
+        *action = RET_ALLOW;
+    } else if (strcmp(s, "notify") == 0) {
+        *action = RET_NOTIFY;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+static int parse_value(const char *s, uint32_t *value) {
+    size_t i;
+    char *end;
+    unsigned long long v;
+
+    for (i = 0; i < TABLE_LEN(named_values); i++) {
+        if (strcmp(named_values[i].name, s) == 0) {
+            *value = named_values[i].value;
+            return 0;
+        }
+    }
+    errno = 0;
+    v = strtoull(s, &end, 0);
+    if (*s == '\0' || *end != '\0' || errno != 0) {
+        return -1;
+    }
+    *value = (uint32_t)v;  /* Low 32 bits only - see POLICY FILES */
+    return 0;
+}
+
+static int add_hot_syscall(const struct arch_info *arch, struct policy *pol, const char *name) {
+    int nr, i;
+
+    nr = lookup_syscall(arch, name);
+    if (nr < 0) {
+        return 0;  /* Not on this arch (e.g. epoll_wait on aarch64) */
+    }
+    for (i = 0; i < pol->n_hot; i++) {
+        if (pol->hot[i] == nr) {
+            return 0;
+        }
+    }
+    if (pol->n_hot >= MAX_HOT) {
+        fprintf(stderr, "Error: too many hot syscalls (max %d)\n", MAX_HOT);
+        return -1;
+    }
+    pol->hot[pol->n_hot++] = nr;
+    return 0;
+}
+
+/* Replace the hot set with a comma-separated list ("none" clears it) */
+static int set_hot_list(const struct arch_info *arch, struct policy *pol, const char *list) {
+    char buf[1024];
+    char *p;
+
+    pol->n_hot = 0;
+    pol->hot_given = 1;
+    if (strcmp(list, "none") == 0) {
+        return 0;
+    }
+    snprintf(buf, sizeof(buf), "%s", list);
+    for (p = strtok(buf, ", "); p; p = strtok(NULL, ", ")) {
+        if (add_hot_syscall(arch, pol, p) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static struct rule *policy_rule_for(struct policy *pol, int nr) {
+    int i;
+    for (i = 0; i < pol->n_rules; i++) {
+        if (pol->rules[i].nr == nr) {
+            return &pol->rules[i];
+        }
+    }
+    if (pol->n_rules >= MAX_RULES) {
+        return NULL;
+    }
+    memset(&pol->rules[pol->n_rules], 0, sizeof(struct rule));
+    pol->rules[pol->n_rules].nr = nr;
+    pol->rules[pol->n_rules].arg = ARG_NONE;
+    pol->rules[pol->n_rules].action = RET_ALLOW;
+    return &pol->rules[pol->n_rules++];
+}
+
+/*
+ * Parse one policy line into pol. Returns 0 on success (including blank and
+ * comment lines), -1 with a message on stderr otherwise.
  */
+static int parse_policy_line(const struct arch_info *arch, struct policy *pol,
+                             char *line, const char *src, int lineno) {
+    char *tok[2 + MAX_ARG_VALUES + 1];
+    int ntok = 0;
+    char *p, *hash;
+    uint32_t action;
+    int nr, arg, i, j, existed;
+    struct rule *r;
+
+    hash = strchr(line, '#');
+    if (hash) {
+        *hash = '\0';
+    }
+    for (p = strtok(line, " \t\r\n"); p; p = strtok(NULL, " \t\r\n")) {
+        if (ntok >= (int)TABLE_LEN(tok)) {
+            fprintf(stderr, "Error: %s:%d: too many values (max %d)\n", src, lineno, MAX_ARG_VALUES);
+            return -1;
+        }
+        tok[ntok++] = p;
+    }
+    if (ntok == 0) {
+        return 0;
+    }
+    if (strcmp(tok[0], "hot") == 0) {
+        if (!pol->hot_given) {
+            pol->n_hot = 0;
+            pol->hot_given = 1;
+        }
+        for (i = 1; i < ntok; i++) {
+            if (add_hot_syscall(arch, pol, tok[i]) != 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+    if (ntok < 2) {
+        fprintf(stderr, "Error: %s:%d: expected '<action> <syscall> [arg<N> <value>...]'\n", src, lineno);
+        return -1;
+    }
+    if (parse_action(tok[0], &action) != 0) {
+        fprintf(stderr, "Error: %s:%d: unknown action '%s'\n", src, lineno, tok[0]);
+        return -1;
+    }
+    nr = lookup_syscall(arch, tok[1]);
+    if (nr < 0) {
+        fprintf(stderr, "Error: %s:%d: unknown syscall '%s' for %s\n", src, lineno, tok[1], arch->name);
+        return -1;
+    }
+
+    arg = ARG_NONE;
+    if (ntok > 2) {
+        if (strncmp(tok[2], "arg", 3) != 0 || tok[2][3] < '0' || tok[2][3] > '5' || tok[2][4] != '\0') {
+            fprintf(stderr, "Error: %s:%d: expected arg0..arg5, got '%s'\n", src, lineno, tok[2]);
+            return -1;
+        }
+        arg = tok[2][3] - '0';
+        if (ntok == 3) {
+            fprintf(stderr, "Error: %s:%d: %s needs at least one value\n", src, lineno, tok[2]);
+            return -1;
+        }
+    }
+
+    existed = 0;
+    for (i = 0; i < pol->n_rules; i++) {
+        if (pol->rules[i].nr == nr) {
+            existed = 1;
+        }
+    }
+    r = policy_rule_for(pol, nr);
+    if (!r) {
+        fprintf(stderr, "Error: %s:%d: too many rules (max %d)\n", src, lineno, MAX_RULES);
+        return -1;
+    }
+
+    if (arg == ARG_NONE) {
+        if (existed) {
+            fprintf(stderr, "Error: %s:%d: duplicate rule for syscall '%s'\n", src, lineno, tok[1]);
+            return -1;
+        }
+        r->action = action;
+        return 0;
+    }
+
+    if (existed && r->arg != arg) {
+        fprintf(stderr, "Error: %s:%d: syscall '%s' already has a rule on %s\n", src, lineno, tok[1],
+                r->arg == ARG_NONE ? "all calls" : "a different argument");
+        return -1;
+    }
+    r->arg = arg;
+    for (i = 3; i < ntok; i++) {
+        uint32_t value;
+        if (parse_value(tok[i], &value) != 0) {
+            fprintf(stderr, "Error: %s:%d: bad value '%s'\n", src, lineno, tok[i]);
+            return -1;
+        }
+        for (j = 0; j < r->n_values; j++) {
+            if (r->values[j].value == value) {
+                fprintf(stderr, "Error: %s:%d: duplicate value '%s'\n", src, lineno, tok[i]);
+                return -1;
+            }
+        }
+        if (r->n_values >= MAX_ARG_VALUES) {
+            fprintf(stderr, "Error: %s:%d: too many values (max %d)\n", src, lineno, MAX_ARG_VALUES);
+            return -1;
+        }
+        r->values[r->n_values].value = value;
+        r->values[r->n_values].action = action;
+        r->n_values++;
+    }
+    return 0;
+}
+
+static int load_default_policy(const struct arch_info *arch, struct policy *pol) {
+    size_t i;
+    char line[256];
+
+    for (i = 0; i < TABLE_LEN(default_policy); i++) {
+        snprintf(line, sizeof(line), "%s", default_policy[i]);
+        if (parse_policy_line(arch, pol, line, "<built-in>", (int)i + 1) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int load_policy_file(const struct arch_info *arch, struct policy *pol, const char *path) {
+    FILE *fp;
+    char line[4096];
+    int lineno = 0;
+
+    fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "Error: Cannot open '%s': %s\n", path, strerror(errno));
+        return -1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        lineno++;
+        if (parse_policy_line(arch, pol, line, path, lineno) != 0) {
+            fclose(fp);
+            return -1;
+        }
+    }
+    fclose(fp);
+    return 0;
+}
 
-#if HAS_X32_ABI
 /*
- * x86_64 filter - includes x32 ABI rejection
- * 
- * The x32 ABI uses syscall numbers with bit 30 set (0x40000000).
- * We must reject these to prevent bypass via x32 ioctl.
+ * =============================================================================
+ * BPF PROGRAM GENERATION
+ * =============================================================================
+ *
+ * Logic flow:
+ * 1. Load and validate architecture (kill on mismatch)
+ * 2. Load the syscall number; allow hot-set ranges straight away
+ * 3. [x86_64 only] Reject x32 ABI syscalls
+ * 4. Binary search over the sorted rule syscall numbers (JGE per level,
+ *    JEQ at the leaves); unmatched numbers fall through to ALLOW
+ * 5. For argument rules, load args[N] (low 32 bits only!) and binary
+ *    search the sorted value set the same way
+ *
+ * Every subtree is generated into its own buffer so the parent knows its
+ * exact length before emitting the jump over it. Conditional jumps only
+ * reach 255 instructions; longer skips go through a BPF_JA trampoline.
  */
-static struct sock_filter filter[] = {
-    /* [0] Load architecture */
-    BPF_STMT(BPF_LD | BPF_W | BPF_ABS, OFF_ARCH),
-    
-    /* [1] Verify architecture == x86_64, else kill */
-    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, CURRENT_ARCH, 1, 0),
-    
-    /* [2] Wrong architecture - kill process */
-    BPF_STMT(BPF_RET | BPF_K, RET_KILL),
-    
-    /* [3] Load syscall number */
-    BPF_STMT(BPF_LD | BPF_W | BPF_ABS, OFF_NR),
-    
-    /* [4] Check x32 ABI bit - if set, deny with EPERM */
-    BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, X32_SYSCALL_BIT, 0, 1),
-    
-    /* [5] x32 syscall detected - return EPERM */
-    BPF_STMT(BPF_RET | BPF_K, RET_ERRNO(EPERM)),
-    
-    /* [6] Check if syscall == ioctl */
-    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, CURRENT_IOCTL, 1, 0),
-    
-    /* [7] Not ioctl - allow */
-    BPF_STMT(BPF_RET | BPF_K, RET_ALLOW),
-    
-    /* [8] Load ioctl cmd (arg1, low 32 bits only for security) */
-    BPF_STMT(BPF_LD | BPF_W | BPF_ABS, OFF_ARG1_LO),
-    
-    /* [9] Check if cmd == TIOCSTI */
-    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, TIOCSTI, 2, 0),
-    
-    /* [10] Check if cmd == TIOCLINUX */
-    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, TIOCLINUX, 1, 0),
-    
-    /* [11] Not a blocked ioctl - allow */
-    BPF_STMT(BPF_RET | BPF_K, RET_ALLOW),
-    
-    /* [12] Blocked ioctl - return EPERM */
-    BPF_STMT(BPF_RET | BPF_K, RET_ERRNO(EPERM)),
+
+struct prog {
+    struct sock_filter *insns;
+    size_t len;
+    size_t cap;
 };
 
-#else
+static void prog_push(struct prog *p, struct sock_filter insn) {
+    if (p->len == p->cap) {
+        p->cap = p->cap ? p->cap * 2 : 32;
+        p->insns = realloc(p->insns, p->cap * sizeof(struct sock_filter));
+        if (!p->insns) {
+            fprintf(stderr, "Error: out of memory\n");
+            exit(1);
+        }
+    }
+    p->insns[p->len++] = insn;
+}
+
+static void prog_append(struct prog *dst, struct prog *src) {
+    size_t i;
+    for (i = 0; i < src->len; i++) {
+        prog_push(dst, src->insns[i]);
+    }
+    free(src->insns);
+    src->insns = NULL;
+    src->len = src->cap = 0;
+}
+
+static void prog_stmt(struct prog *p, uint16_t code, uint32_t k) {
+    struct sock_filter insn = BPF_STMT(code, k);
+    prog_push(p, insn);
+}
+
+static void prog_jump(struct prog *p, uint16_t code, uint32_t k, uint8_t jt, uint8_t jf) {
+    struct sock_filter insn = BPF_JUMP(code, k, jt, jf);
+    prog_push(p, insn);
+}
+
+/*
+ * Emit "if (A >= pivot) goto right; else fall into left" followed by both
+ * subtrees. Left is placed first so the false branch falls through.
+ */
+static void emit_split(struct prog *out, uint32_t pivot, struct prog *left, struct prog *right) {
+    if (left->len <= 255) {
+        prog_jump(out, BPF_JMP | BPF_JGE | BPF_K, pivot, (uint8_t)left->len, 0);
+    } else {
+        /* jt: next insn (JA over left), jf: skip the JA into left */
+        prog_jump(out, BPF_JMP | BPF_JGE | BPF_K, pivot, 0, 1);
+        prog_stmt(out, BPF_JMP | BPF_JA, (uint32_t)left->len);
+    }
+    prog_append(out, left);
+    prog_append(out, right);
+}
+
 /*
- * Non-x86_64 filter (aarch64, i386, arm) - no x32 ABI
+ * =============================================================================
+ * BPF EMULATION
+ * =============================================================================
+ *
+ * A small classic-BPF interpreter for the instruction subset emitted here.
+ * It measures how many instructions each syscall actually executes, which
+ * drives the hot-set layout and the cost report.
  */
-static struct sock_filter filter[] = {
-    /* [0] Load architecture */
-    BPF_STMT(BPF_LD | BPF_W | BPF_ABS, OFF_ARCH),
-    
-    /* [1] Verify architecture matches, else kill */
-    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, CURRENT_ARCH, 1, 0),
-    
-    /* [2] Wrong architecture - kill process */
-    BPF_STMT(BPF_RET | BPF_K, RET_KILL),
-    
-    /* [3] Load syscall number */
-    BPF_STMT(BPF_LD | BPF_W | BPF_ABS, OFF_NR),
-    
-    /* [4] Check if syscall == ioctl */
-    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, CURRENT_IOCTL, 1, 0),
-    
-    /* [5] Not ioctl - allow */
-    BPF_STMT(BPF_RET | BPF_K, RET_ALLOW),
-    
-    /* [6] Load ioctl cmd (arg1, low 32 bits only for security) */
-    BPF_STMT(BPF_LD | BPF_W | BPF_ABS, OFF_ARG1_LO),
-    
-    /* [7] Check if cmd == TIOCSTI */
-    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, TIOCSTI, 2, 0),
-    
-    /* [8] Check if cmd == TIOCLINUX */
-    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, TIOCLINUX, 1, 0),
-    
-    /* [9] Not a blocked ioctl - allow */
-    BPF_STMT(BPF_RET | BPF_K, RET_ALLOW),
-    
-    /* [10] Blocked ioctl - return EPERM */
-    BPF_STMT(BPF_RET | BPF_K, RET_ERRNO(EPERM)),
+
+#define SECCOMP_DATA_SIZE 64
+
+struct sim_data {
+    uint8_t bytes[SECCOMP_DATA_SIZE];  /* struct seccomp_data image */
 };
-#endif
 
-#define FILTER_LEN (sizeof(filter) / sizeof(filter[0]))
+static void sim_put32(struct sim_data *d, uint32_t off, uint32_t v) {
+    d->bytes[off] = (uint8_t)v;
+    d->bytes[off + 1] = (uint8_t)(v >> 8);
+    d->bytes[off + 2] = (uint8_t)(v >> 16);
+    d->bytes[off + 3] = (uint8_t)(v >> 24);
+}
 
-int main(int argc, char *argv[]) {
-    FILE *fp;
-    size_t written;
-
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <output-file>\n\n", argv[0]);
-        fprintf(stderr, "Generates a seccomp BPF filter that blocks TIOCSTI and TIOCLINUX ioctls.\n");
-        fprintf(stderr, "The output file can be used with bubblewrap's --seccomp option.\n\n");
-        fprintf(stderr, "Example:\n");
-        fprintf(stderr, "  %s /tmp/filter.bpf\n", argv[0]);
-        fprintf(stderr, "  bwrap --seccomp 3 3</tmp/filter.bpf --ro-bind / / /bin/sh\n");
-        return 1;
+static uint32_t sim_get32(const struct sim_data *d, uint32_t off) {
+    return (uint32_t)d->bytes[off] | (uint32_t)d->bytes[off + 1] << 8 |
+           (uint32_t)d->bytes[off + 2] << 16 | (uint32_t)d->bytes[off + 3] << 24;
+}
+
+/*
+ * Build a seccomp_data image; arg < 0 leaves all arguments zero. Words are
+ * kept in one byte order and only the argument word placement follows the
+ * target, which is all a program made of 32-bit loads can observe.
+ */
+static void sim_init(struct sim_data *d, const struct arch_info *arch, uint32_t nr, int arg, uint32_t value) {
+    memset(d, 0, sizeof(*d));
+    sim_put32(d, OFF_NR, nr);
+    sim_put32(d, OFF_ARCH, arch->audit_arch);
+    if (arg >= 0) {
+        sim_put32(d, OFF_ARG_LO(arch, arg), value);
     }
+}
 
-    printf("Generating seccomp BPF filter for TIOCSTI/TIOCLINUX blocking\n");
-    printf("  Architecture:    %s\n", ARCH_NAME);
-    printf("  Audit arch:      0x%08x\n", CURRENT_ARCH);
-    printf("  ioctl syscall:   %d\n", CURRENT_IOCTL);
-    printf("  TIOCSTI:         0x%04x\n", TIOCSTI);
-    printf("  TIOCLINUX:       0x%04x\n", TIOCLINUX);
-#if HAS_X32_ABI
-    printf("  x32 ABI:         blocked\n");
-#endif
-    printf("  Instructions:    %zu\n", FILTER_LEN);
-    printf("  Filter size:     %zu bytes\n", sizeof(filter));
+/*
+ * Run the program; returns the action and stores the executed count in
+ * *steps. With args_read non-NULL the arguments are treated as unknown, the
+ * way the kernel's action cache builder sees them: the first load of
+ * anything but nr/arch sets *args_read and stops the run.
+ */
+static uint32_t bpf_run(const struct prog *p, const struct sim_data *d, size_t *steps, int *args_read) {
+    size_t pc = 0, n = 0;
+    uint32_t a = 0;
 
-    fp = fopen(argv[1], "wb");
-    if (!fp) {
-        fprintf(stderr, "Error: Cannot open '%s': %s\n", argv[1], strerror(errno));
-        return 1;
+    while (pc < p->len) {
+        const struct sock_filter *insn = &p->insns[pc++];
+        n++;
+        switch (insn->code) {
+        case BPF_LD | BPF_W | BPF_ABS:
+            if (insn->k > SECCOMP_DATA_SIZE - 4 || (insn->k & 3)) {
+                *steps = n;
+                return RET_KILL;
+            }
+            if (args_read && insn->k != OFF_NR && insn->k != OFF_ARCH) {
+                *args_read = 1;
+                *steps = n;
+                return RET_KILL;
+            }
+            a = sim_get32(d, insn->k);
+            break;
+        case BPF_JMP | BPF_JA:
+            pc += insn->k;
+            break;
+        case BPF_JMP | BPF_JEQ | BPF_K:
+            pc += (a == insn->k) ? insn->jt : insn->jf;
+            break;
+        case BPF_JMP | BPF_JGT | BPF_K:
+            pc += (a > insn->k) ? insn->jt : insn->jf;
+            break;
+        case BPF_JMP | BPF_JGE | BPF_K:
+            pc += (a >= insn->k) ? insn->jt : insn->jf;
+            break;
+        case BPF_JMP | BPF_JSET | BPF_K:
+            pc += (a & insn->k) ? insn->jt : insn->jf;
+            break;
+        case BPF_RET | BPF_K:
+            *steps = n;
+            return insn->k;
+        default:
+            *steps = n;
+            return RET_KILL;
+        }
     }
+    *steps = n;
+    return RET_KILL;  /* Fell off the end; the kernel would reject this */
+}
 
-    written = fwrite(filter, sizeof(struct sock_filter), FILTER_LEN, fp);
-    if (written != FILTER_LEN) {
-        fprintf(stderr, "Error: Write failed: %s\n", strerror(errno));
-        fclose(fp);
-        return 1;
+/* Action for nr if it does not depend on the arguments; returns 0 otherwise */
+static int const_action(const struct prog *p, const struct arch_info *arch, uint32_t nr, uint32_t *action) {
+    struct sim_data d;
+    size_t steps;
+    int args_read = 0;
+
+    sim_init(&d, arch, nr, -1, 0);
+    *action = bpf_run(p, &d, &steps, &args_read);
+    return !args_read;
+}
+
+static size_t syscall_steps(const struct prog *p, const struct arch_info *arch, uint32_t nr,
+                            int arg, uint32_t value) {
+    struct sim_data d;
+    size_t steps;
+    sim_init(&d, arch, nr, arg, value);
+    bpf_run(p, &d, &steps, NULL);
+    return steps;
+}
+
+static int cmp_arg_match(const void *a, const void *b) {
+    uint32_t x = ((const struct arg_match *)a)->value;
+    uint32_t y = ((const struct arg_match *)b)->value;
+    return x < y ? -1 : x > y;
+}
+
+static int cmp_rule(const void *a, const void *b) {
+    int x = ((const struct rule *)a)->nr;
+    int y = ((const struct rule *)b)->nr;
+    return x < y ? -1 : x > y;
+}
+
+/* Value tree over values[lo, hi) with args[N] already in A */
+static void emit_value_tree(struct prog *out, const struct arg_match *values, int lo, int hi) {
+    if (hi - lo == 1) {
+        prog_jump(out, BPF_JMP | BPF_JEQ | BPF_K, values[lo].value, 0, 1);
+        prog_stmt(out, BPF_RET | BPF_K, values[lo].action);
+        prog_stmt(out, BPF_RET | BPF_K, RET_ALLOW);
+    } else {
+        int mid = lo + (hi - lo) / 2;
+        struct prog left = { 0 }, right = { 0 };
+        emit_value_tree(&left, values, lo, mid);
+        emit_value_tree(&right, values, mid, hi);
+        emit_split(out, values[mid].value, &left, &right);
     }
+}
 
-    fclose(fp);
-    printf("Successfully wrote filter to: %s\n", argv[1]);
+static void emit_rule_body(struct prog *out, const struct arch_info *arch, const struct rule *r) {
+    if (r->arg == ARG_NONE) {
+        prog_stmt(out, BPF_RET | BPF_K, r->action);
+        return;
+    }
+    prog_stmt(out, BPF_LD | BPF_W | BPF_ABS, OFF_ARG_LO(arch, r->arg));
+    emit_value_tree(out, r->values, 0, r->n_values);
+}
 
+/* Syscall tree over rules[lo, hi) with the syscall number in A */
+static void emit_syscall_tree(struct prog *out, const struct arch_info *arch,
+                              const struct rule *rules, int lo, int hi) {
+    if (hi - lo == 1) {
+        prog_jump(out, BPF_JMP | BPF_JEQ | BPF_K, (uint32_t)rules[lo].nr, 1, 0);
+        prog_stmt(out, BPF_RET | BPF_K, RET_ALLOW);
+        emit_rule_body(out, arch, &rules[lo]);
+    } else {
+        int mid = lo + (hi - lo) / 2;
+        struct prog left = { 0 }, right = { 0 };
+        emit_syscall_tree(&left, arch, rules, lo, mid);
+        emit_syscall_tree(&right, arch, rules, mid, hi);
+        emit_split(out, (uint32_t)rules[mid].nr, &left, &right);
+    }
+}
+
+/* Highest syscall number the hot ranges may cover */
+static uint32_t nr_limit(const struct arch_info *arch) {
+    return arch->has_x32_abi ? X32_SYSCALL_BIT - 1 : 0xffffffffU;
+}
+
+static const struct rule *find_rule(const struct policy *pol, int nr) {
+    int i;
+    for (i = 0; i < pol->n_rules; i++) {
+        if (pol->rules[i].nr == nr) {
+            return &pol->rules[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Widest range of syscall numbers around nr that contains no rule, so the
+ * whole range can be allowed with two compares. Rules must be sorted.
+ */
+static struct nr_range free_range_around(const struct arch_info *arch, const struct policy *pol, int nr) {
+    struct nr_range r = { 0, 0 };
+    int i;
+
+    r.hi = nr_limit(arch);
+    for (i = 0; i < pol->n_rules; i++) {
+        if (pol->rules[i].nr < nr) {
+            r.lo = (uint32_t)pol->rules[i].nr + 1;
+        } else if (pol->rules[i].nr > nr) {
+            r.hi = (uint32_t)pol->rules[i].nr - 1;
+            break;
+        }
+    }
+    return r;
+}
+
+/*
+ * "if (lo <= A <= hi) return ALLOW", falling through otherwise. Only a
+ * range that reaches 0xffffffff may skip the upper compare: on x86_64 the
+ * limit sits below the x32 bit, and those numbers must reach the x32 check.
+ */
+static void emit_range_allow(struct prog *out, struct nr_range r) {
+    if (r.lo > 0 && r.hi < 0xffffffffU) {
+        prog_jump(out, BPF_JMP | BPF_JGE | BPF_K, r.lo, 0, 2);
+        prog_jump(out, BPF_JMP | BPF_JGT | BPF_K, r.hi, 1, 0);
+    } else if (r.lo > 0) {
+        prog_jump(out, BPF_JMP | BPF_JGE | BPF_K, r.lo, 0, 1);
+    } else if (r.hi < 0xffffffffU) {
+        prog_jump(out, BPF_JMP | BPF_JGT | BPF_K, r.hi, 1, 0);
+    }
+    prog_stmt(out, BPF_RET | BPF_K, RET_ALLOW);
+}
+
+static void emit_program(struct prog *out, const struct arch_info *arch, const struct policy *pol,
+                         const struct nr_range *hot, int n_hot) {
+    int i;
+
+    /* Load architecture; wrong architecture - kill process */
+    prog_stmt(out, BPF_LD | BPF_W | BPF_ABS, OFF_ARCH);
+    prog_jump(out, BPF_JMP | BPF_JEQ | BPF_K, arch->audit_arch, 1, 0);
+    prog_stmt(out, BPF_RET | BPF_K, RET_KILL);
+
+    /* Load syscall number */
+    prog_stmt(out, BPF_LD | BPF_W | BPF_ABS, OFF_NR);
+
+    /*
+     * Hot ranges are capped below the x32 bit, so they are safe to test
+     * before the x32 check and save that instruction on the hot path.
+     */
+    for (i = 0; i < n_hot; i++) {
+        emit_range_allow(out, hot[i]);
+    }
+
+    /* x32 syscall detected - return EPERM */
+    if (arch->has_x32_abi) {
+        prog_jump(out, BPF_JMP | BPF_JSET | BPF_K, X32_SYSCALL_BIT, 0, 1);
+        prog_stmt(out, BPF_RET | BPF_K, RET_ERRNO(EPERM));
+    }
+
+    if (pol->n_rules == 0) {
+        prog_stmt(out, BPF_RET | BPF_K, RET_ALLOW);
+        return;
+    }
+    emit_syscall_tree(out, arch, pol->rules, 0, pol->n_rules);
+}
+
+static size_t hot_set_steps(const struct prog *p, const struct arch_info *arch, const struct policy *pol) {
+    size_t total = 0;
+    int i;
+    for (i = 0; i < pol->n_hot; i++) {
+        total += syscall_steps(p, arch, (uint32_t)pol->hot[i], -1, 0);
+    }
+    return total;
+}
+
+static int is_hot_nr(const struct policy *pol, uint32_t nr) {
+    int i;
+    for (i = 0; i < pol->n_hot; i++) {
+        if ((uint32_t)pol->hot[i] == nr) {
+            return 1;
+        }
+    }
     return 0;
 }
+
+/* Total over the "other" syscalls of the cost report */
+static size_t tail_steps(const struct prog *p, const struct arch_info *arch, const struct policy *pol) {
+    uint32_t nr, scan_max = arch_max_nr(arch);
+    size_t total = 0;
+    for (nr = 0; nr <= scan_max; nr++) {
+        if (!is_hot_nr(pol, nr) && !find_rule(pol, (int)nr)) {
+            total += syscall_steps(p, arch, nr, -1, 0);
+        }
+    }
+    return total;
+}
+
+/* Hot syscalls left to the rule tree by the chosen ranges */
+static int hot_in_tree(const struct policy *pol, const struct nr_range *ranges, int n_ranges) {
+    int i, j, n = 0;
+    for (i = 0; i < pol->n_hot; i++) {
+        for (j = 0; j < n_ranges; j++) {
+            if ((uint32_t)pol->hot[i] >= ranges[j].lo && (uint32_t)pol->hot[i] <= ranges[j].hi) {
+                break;
+            }
+        }
+        n += j == n_ranges;
+    }
+    return n;
+}
+
+/* Clusters considered by the exhaustive search; later ones go to the tree */
+#define MAX_SEARCH_CLUSTERS 6
+
+struct cluster_search {
+    const struct arch_info *arch;
+    const struct policy *pol;
+    struct nr_range clusters[MAX_HOT];
+    int n_clusters;
+    struct nr_range order[MAX_SEARCH_CLUSTERS];
+    struct nr_range best[MAX_SEARCH_CLUSTERS];
+    int n_best;
+    size_t best_hot, best_tail;
+    int best_in_tree;
+};
+
+/*
+ * Score the first depth entries of s->order, then extend it with every
+ * unused cluster. Lower hot-set cost wins; ties go to the order that
+ * leaves fewer hot syscalls in the tree (their cost then no longer
+ * depends on how many rules there are), then to the cheaper tail.
+ */
+static void search_clusters(struct cluster_search *s, int depth, unsigned used) {
+    struct prog trial = { 0 };
+    size_t hot, tail;
+    int i, in_tree;
+
+    emit_program(&trial, s->arch, s->pol, s->order, depth);
+    hot = hot_set_steps(&trial, s->arch, s->pol);
+    in_tree = hot_in_tree(s->pol, s->order, depth);
+    if (hot < s->best_hot || (hot == s->best_hot && in_tree <= s->best_in_tree)) {
+        tail = tail_steps(&trial, s->arch, s->pol);
+        if (hot < s->best_hot || in_tree < s->best_in_tree || tail < s->best_tail) {
+            s->best_hot = hot;
+            s->best_in_tree = in_tree;
+            s->best_tail = tail;
+            s->n_best = depth;
+            memcpy(s->best, s->order, sizeof(s->order[0]) * (size_t)depth);
+        }
+    }
+    free(trial.insns);
+
+    for (i = 0; i < s->n_clusters && i < MAX_SEARCH_CLUSTERS; i++) {
+        if (!(used & (1U << i))) {
+            s->order[depth] = s->clusters[i];
+            search_clusters(s, depth + 1, used | (1U << i));
+        }
+    }
+}
+
+/*
+ * Sort the policy, then group the hot syscalls into clusters: the hot
+ * syscalls that fall between the same two rules are allowed by a single
+ * JGE/JGT pair bounded by the lowest and highest of them, ahead of the x32
+ * check and the tree. Which clusters to emit, and in what order, is decided by running
+ * every candidate program through the emulator. Hot syscalls with a rule
+ * of their own stay in the tree.
+ */
+static void compile_policy(struct prog *out, const struct arch_info *arch, struct policy *pol) {
+    struct cluster_search s;
+    struct nr_range gaps[MAX_HOT], gap;
+    const struct rule *r;
+    uint32_t nr;
+    int i, j;
+
+    qsort(pol->rules, (size_t)pol->n_rules, sizeof(struct rule), cmp_rule);
+    for (i = 0; i < pol->n_rules; i++) {
+        qsort(pol->rules[i].values, (size_t)pol->rules[i].n_values, sizeof(struct arg_match), cmp_arg_match);
+    }
+
+    memset(&s, 0, sizeof(s));
+    s.arch = arch;
+    s.pol = pol;
+    for (i = 0; i < pol->n_hot; i++) {
+        r = find_rule(pol, pol->hot[i]);
+        if (r && r->arg != ARG_NONE) {
+            fprintf(stderr, "Warning: hot syscall '%s' has an argument rule; it always runs the full filter "
+                    "and can never use the kernel's constant-action cache (Linux 5.11+)\n",
+                    syscall_name(arch, pol->hot[i]));
+            continue;
+        }
+        if (r) {
+            fprintf(stderr, "Note: hot syscall '%s' has a rule; it is dispatched by the rule tree\n",
+                    syscall_name(arch, pol->hot[i]));
+            continue;
+        }
+        gap = free_range_around(arch, pol, pol->hot[i]);
+        nr = (uint32_t)pol->hot[i];
+        for (j = 0; j < s.n_clusters; j++) {
+            if (gaps[j].lo == gap.lo) {
+                s.clusters[j].lo = nr < s.clusters[j].lo ? nr : s.clusters[j].lo;
+                s.clusters[j].hi = nr > s.clusters[j].hi ? nr : s.clusters[j].hi;
+                break;
+            }
+        }
+        if (j == s.n_clusters) {
+            gaps[j] = gap;
+            s.clusters[j].lo = s.clusters[j].hi = nr;
+            s.n_clusters++;
+        }
+    }
+
+    s.best_hot = (size_t)-1;
+    s.best_tail = (size_t)-1;
+    s.best_in_tree = pol->n_hot + 1;
+    search_clusters(&s, 0, 0);
+
+    pol->n_hot_ranges = s.n_best;
+    memcpy(pol->hot_ranges, s.best, sizeof(s.best[0]) * (size_t)s.n_best);
+    emit_program(out, arch, pol, pol->hot_ranges, pol->n_hot_ranges);
+}
+
+static const char *action_name(uint32_t action, char *buf, size_t size) {
+    if (action == RET_ALLOW) {
+        return "allow";
+    }
+    if (action == RET_KILL) {
+        return "kill";
+    }
+    if (action == RET_NOTIFY) {
+        return "notify";
+    }
+    if ((action & ~SECCOMP_RET_DATA) == SECCOMP_RET_ERRNO) {
+        snprintf(buf, size, "errno:%u", action & SECCOMP_RET_DATA);
+        return buf;
+    }
+    snprintf(buf, size, "0x%08x", action);
+    return buf;
+}
+
+static void print_rules(const struct arch_info *arch, const struct policy *pol) {
+    int i, j;
+    char buf[32];
+
+    for (i = 0; i < pol->n_rules; i++) {
+        const struct rule *r = &pol->rules[i];
+        if (r->arg == ARG_NONE) {
+            printf("  Rule:            %s (%d) -> %s\n", syscall_name(arch, r->nr), r->nr,
+                   action_name(r->action, buf, sizeof(buf)));
+            continue;
+        }
+        printf("  Rule:            %s (%d) arg%d in {", syscall_name(arch, r->nr), r->nr, r->arg);
+        for (j = 0; j < r->n_values; j++) {
+            printf("%s0x%x", j ? ", " : "", r->values[j].value);
+        }
+        printf("} -> %s\n", action_name(r->values[0].action, buf, sizeof(buf)));
+    }
+}
+
+/* Smallest value not in the rule's value set, to measure the no-match path */
+static uint32_t unmatched_value(const struct rule *r) {
+    uint32_t v = 0;
+    int j;
+    for (j = 0; j < r->n_values; j++) {
+        if (r->values[j].value == v) {
+            v++;
+            j = -1;
+        }
+    }
+    return v;
+}
+
+/*
+ * Expected instructions executed per syscall class. "other" covers every
+ * syscall number up to the highest one in the arch table that is neither
+ * hot nor ruled; that is the price the long tail pays for the hot set.
+ */
+static void print_cost_report(const struct arch_info *arch, const struct policy *pol, const struct prog *p) {
+    size_t steps, min = (size_t)-1, max = 0, total = 0, count = 0;
+    uint32_t nr, scan_max;
+    struct sim_data d;
+    int j, k;
+
+    printf("  Hot set:        ");
+    for (j = 0; j < pol->n_hot; j++) {
+        printf(" %s", syscall_name(arch, pol->hot[j]));
+    }
+    printf("%s\n", pol->n_hot ? "" : " (none)");
+    for (j = 0; j < pol->n_hot_ranges; j++) {
+        printf("  Hot range:       %u-%u\n", pol->hot_ranges[j].lo, pol->hot_ranges[j].hi);
+    }
+
+    printf("  Instructions per syscall:\n");
+    for (j = 0; j < pol->n_hot; j++) {
+        printf("    hot    %-18s %3zu\n", syscall_name(arch, pol->hot[j]),
+               syscall_steps(p, arch, (uint32_t)pol->hot[j], -1, 0));
+    }
+    for (j = 0; j < pol->n_rules; j++) {
+        const struct rule *r = &pol->rules[j];
+        if (r->arg == ARG_NONE) {
+            printf("    rule   %-18s %3zu\n", syscall_name(arch, r->nr), syscall_steps(p, arch, (uint32_t)r->nr, -1, 0));
+            continue;
+        }
+        min = max = syscall_steps(p, arch, (uint32_t)r->nr, r->arg, unmatched_value(r));
+        for (k = 0; k < r->n_values; k++) {
+            steps = syscall_steps(p, arch, (uint32_t)r->nr, r->arg, r->values[k].value);
+            min = steps < min ? steps : min;
+            max = steps > max ? steps : max;
+        }
+        printf("    rule   %-18s %3zu-%zu (reads arg%d; never action-cached)\n", syscall_name(arch, r->nr),
+               min, max, r->arg);
+    }
+
+    scan_max = arch_max_nr(arch);
+    min = (size_t)-1;
+    max = 0;
+    for (nr = 0; nr <= scan_max; nr++) {
+        if (is_hot_nr(pol, nr) || find_rule(pol, (int)nr)) {
+            continue;
+        }
+        steps = syscall_steps(p, arch, nr, -1, 0);
+        min = steps < min ? steps : min;
+        max = steps > max ? steps : max;
+        total += steps;
+        count++;
+    }
+    if (count) {
+        printf("    other  %-18s %3zu-%zu (mean %.1f over %zu syscalls)\n", "(default allow)", min, max,
+               (double)total / (double)count, count);
+    }
+    if (arch->has_x32_abi) {
+        printf("    x32    %-18s %3zu\n", "(rejected)", syscall_steps(p, arch, X32_SYSCALL_BIT, -1, 0));
+    }
+    sim_init(&d, arch, 0, -1, 0);
+    sim_put32(&d, OFF_ARCH, ~arch->audit_arch);
+    bpf_run(p, &d, &steps, NULL);
+    printf("    arch   %-18s %3zu\n", "(foreign, killed)", steps);
+}
+
+/*
+ * Since Linux 5.11 the kernel emulates each filter at load time with the
+ * arguments unknown and keeps a per-arch bitmap of syscalls that are
+ * ALLOWed regardless of them; those never run BPF again. Mirror that
+ * analysis for every syscall number the arch table knows about. Returns
+ * the number of hot syscalls that fell off the cached path.
+ */
+static int print_cache_analysis(const struct arch_info *arch, const struct policy *pol, const struct prog *p) {
+    uint32_t nr, action, max_nr = arch_max_nr(arch);
+    size_t n_cached = 0, n_const = 0, n_eval = 0;
+    char buf[32];
+    int j, uncached_hot = 0;
+
+    printf("Action cache analysis for %s (syscalls 0-%u)\n", arch->name, max_nr);
+    for (nr = 0; nr <= max_nr; nr++) {
+        if (!const_action(p, arch, nr, &action)) {
+            n_eval++;
+        } else if (action == RET_ALLOW) {
+            n_cached++;
+        } else {
+            n_const++;
+        }
+    }
+    printf("  Constant ALLOW:  %zu (cached, filter skipped)\n", n_cached);
+    printf("  Constant action: %zu (argument-independent, evaluated every call)\n", n_const);
+    for (nr = 0; nr <= max_nr; nr++) {
+        if (const_action(p, arch, nr, &action) && action != RET_ALLOW) {
+            printf("    %-18s %4u -> %s\n", syscall_name(arch, (int)nr), nr, action_name(action, buf, sizeof(buf)));
+        }
+    }
+    printf("  Needs args:      %zu (full evaluation every call)\n", n_eval);
+    for (nr = 0; nr <= max_nr; nr++) {
+        if (!const_action(p, arch, nr, &action)) {
+            printf("    %-18s %4u\n", syscall_name(arch, (int)nr), nr);
+        }
+    }
+    for (j = 0; j < pol->n_hot; j++) {
+        if (!const_action(p, arch, (uint32_t)pol->hot[j], &action) || action != RET_ALLOW) {
+            fprintf(stderr, "Warning: hot syscall '%s' is not on the cached path\n", syscall_name(arch, pol->hot[j]));
+            uncached_hot++;
+        }
+    }
+    if (uncached_hot == 0) {
+        printf("  Hot set:         all cached\n");
+    }
+    return uncached_hot;
+}
+
+/*
+ * =============================================================================
+ * OUTPUT
+ * =============================================================================
+ *
+ * Filters are serialized field by field in the target's byte order, so a
+ * bundle built on x86_64 carries a usable s390x program.
+ *
+ * BUNDLE FORMAT
+ *
+ * One file holds the filter for every architecture, so the sandbox picks
+ * its own with a single dd and never needs a compiler. The header is plain
+ * text that bash can `read`, NUL-padded to BUNDLE_HEADER_SIZE bytes:
+ *
+ *   cco-seccomp-bundle 1
+ *   <arch> <offset> <instructions> <cksum>
+ *   ...
+ *   end
+ *
+ * <offset> is in bytes from the start of the file and is a multiple of 8;
+ * the blob is <instructions> * 8 bytes long. <cksum> is the CRC printed by
+ * POSIX cksum(1) over the blob, so the reader can verify what it extracted.
+ */
+
+#define BUNDLE_MAGIC        "cco-seccomp-bundle 1"
+#define BUNDLE_HEADER_SIZE  512
+#define FILTER_INSN_SIZE    8
+
+static size_t encode_prog(const struct arch_info *arch, const struct prog *p, uint8_t **out) {
+    uint8_t *buf = malloc(p->len * FILTER_INSN_SIZE + 1);
+    size_t i;
+
+    if (!buf) {
+        fprintf(stderr, "Error: out of memory\n");
+        exit(1);
+    }
+    for (i = 0; i < p->len; i++) {
+        const struct sock_filter *insn = &p->insns[i];
+        uint8_t *b = &buf[i * FILTER_INSN_SIZE];
+        if (arch->big_endian) {
+            b[0] = (uint8_t)(insn->code >> 8);
+            b[1] = (uint8_t)insn->code;
+            b[4] = (uint8_t)(insn->k >> 24);
+            b[5] = (uint8_t)(insn->k >> 16);
+            b[6] = (uint8_t)(insn->k >> 8);
+            b[7] = (uint8_t)insn->k;
+        } else {
+            b[0] = (uint8_t)insn->code;
+            b[1] = (uint8_t)(insn->code >> 8);
+            b[4] = (uint8_t)insn->k;
+            b[5] = (uint8_t)(insn->k >> 8);
+            b[6] = (uint8_t)(insn->k >> 16);
+            b[7] = (uint8_t)(insn->k >> 24);
+        }
+        b[2] = insn->jt;
+        b[3] = insn->jf;
+    }
+    *out = buf;
+    return p->len * FILTER_INSN_SIZE;
+}
+
+static uint32_t cksum_byte(uint32_t crc, uint8_t byte) {
+    int bit;
+    crc ^= (uint32_t)byte << 24;
+    for (bit = 0; bit < 8; bit++) {
+        crc = (crc & 0x80000000U) ? (crc << 1) ^ 0x04c11db7U : crc << 1;
+    }
+    return crc;
+}
+
+/* CRC printed by POSIX cksum(1): the data, then its length LSB first */
+static uint32_t posix_cksum(const uint8_t *buf, size_t len) {
+    uint32_t crc = 0;
+    size_t i, n;
+
+    for (i = 0; i < len; i++) {
+        crc = cksum_byte(crc, buf[i]);
+    }
+    for (n = len; n; n >>= 8) {
+        crc = cksum_byte(crc, (uint8_t)n);
+    }
+    return ~crc;
+}
+
+/* Inverse of encode_prog(); returns -1 if len is not a whole program */
+static int decode_prog(const struct arch_info *arch, const uint8_t *buf, size_t len, struct prog *out) {
+    size_t i;
+
+    if (len % FILTER_INSN_SIZE != 0) {
+        return -1;
+    }
+    for (i = 0; i < len; i += FILTER_INSN_SIZE) {
+        const uint8_t *b = &buf[i];
+        struct sock_filter insn;
+        if (arch->big_endian) {
+            insn.code = (uint16_t)(b[0] << 8 | b[1]);
+            insn.k = (uint32_t)b[4] << 24 | (uint32_t)b[5] << 16 | (uint32_t)b[6] << 8 | b[7];
+        } else {
+            insn.code = (uint16_t)(b[1] << 8 | b[0]);
+            insn.k = (uint32_t)b[7] << 24 | (uint32_t)b[6] << 16 | (uint32_t)b[5] << 8 | b[4];
+        }
+        insn.jt = b[2];
+        insn.jf = b[3];
+        prog_push(out, insn);
+    }
+    return 0;
+}
+
+static int write_file(const char *path, const uint8_t *buf, size_t len) {
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        fprintf(stderr, "Error: Cannot open '%s': %s\n", path, strerror(errno));
+        return 1;
+    }
+    if (fwrite(buf, 1, len, fp) != len || fclose(fp) != 0) {
+        fprintf(stderr, "Error: Write failed: %s\n", strerror(errno));
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * =============================================================================
+ * VERIFICATION
+ * =============================================================================
+ *
+ * Every program is checked structurally before it is written: each jump
+ * must land inside the program, loads must stay inside seccomp_data, and
+ * the last instruction must return, as the kernel requires. --fuzz then
+ * runs a synthetic seccomp_data corpus through the emulator and compares
+ * each result with a reference decision computed straight from the policy,
+ * so jump offsets are never trusted. --verify applies the same checks to
+ * an existing filter file, e.g. the ones written by generate_bpf.py.
+ */
+
+#define BPF_MAXINSNS 4096
+
+static int verify_prog(const struct prog *p) {
+    size_t pc, next;
+    const char *why = NULL;
+
+    if (p->len == 0 || p->len > BPF_MAXINSNS) {
+        fprintf(stderr, "Error: program has %zu instructions (must be 1-%d)\n", p->len, BPF_MAXINSNS);
+        return -1;
+    }
+    for (pc = 0; pc < p->len && !why; pc++) {
+        const struct sock_filter *insn = &p->insns[pc];
+        next = pc + 1;
+        switch (insn->code) {
+        case BPF_LD | BPF_W | BPF_ABS:
+            if (insn->k > SECCOMP_DATA_SIZE - 4 || (insn->k & 3)) {
+                why = "load outside seccomp_data";
+            }
+            break;
+        case BPF_JMP | BPF_JA:
+            if (insn->k >= p->len - next) {
+                why = "jump out of range";
+            }
+            break;
+        case BPF_JMP | BPF_JEQ | BPF_K:
+        case BPF_JMP | BPF_JGT | BPF_K:
+        case BPF_JMP | BPF_JGE | BPF_K:
+        case BPF_JMP | BPF_JSET | BPF_K:
+            if (next + insn->jt >= p->len || next + insn->jf >= p->len) {
+                why = "jump out of range";
+            }
+            break;
+        case BPF_RET | BPF_K:
+            break;
+        default:
+            why = "unsupported opcode";
+            break;
+        }
+    }
+    if (!why && p->insns[p->len - 1].code != (BPF_RET | BPF_K)) {
+        pc = p->len;
+        why = "program does not end with a return";
+    }
+    if (why) {
+        fprintf(stderr, "Error: instruction %zu (code 0x%04x): %s\n", pc - 1, p->insns[pc - 1].code, why);
+        return -1;
+    }
+    return 0;
+}
+
+/* What the policy says should happen, independent of any generated code */
+static uint32_t reference_action(const struct arch_info *arch, const struct policy *pol, const struct sim_data *d) {
+    uint32_t nr = sim_get32(d, OFF_NR), value;
+    const struct rule *r;
+    int i;
+
+    if (sim_get32(d, OFF_ARCH) != arch->audit_arch) {
+        return RET_KILL;
+    }
+    if (arch->has_x32_abi && (nr & X32_SYSCALL_BIT)) {
+        return RET_ERRNO(EPERM);
+    }
+    r = find_rule(pol, (int)nr);
+    if (!r) {
+        return RET_ALLOW;
+    }
+    if (r->arg == ARG_NONE) {
+        return r->action;
+    }
+    value = sim_get32(d, OFF_ARG_LO(arch, r->arg));
+    for (i = 0; i < r->n_values; i++) {
+        if (r->values[i].value == value) {
+            return r->values[i].action;
+        }
+    }
+    return RET_ALLOW;
+}
+
+static uint64_t rng_next(uint64_t *state) {
+    /* xorshift64* */
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545f4914f6cdd1dULL;
+}
+
+/*
+ * One corpus entry: random bytes everywhere (including the high argument
+ * words, which must never matter), then nr/arch/args biased toward the
+ * edges the program branches on.
+ */
+static void fuzz_case(const struct arch_info *arch, const struct policy *pol, uint64_t *rng, struct sim_data *d) {
+    static const uint32_t edges[] = { 0, 1, 0x3fffffffU, X32_SYSCALL_BIT, 0x7fffffffU, 0x80000000U, 0xffffffffU };
+    uint64_t x;
+    uint32_t nr;
+    const struct rule *r = NULL;
+    size_t i;
+
+    for (i = 0; i < SECCOMP_DATA_SIZE; i += 8) {
+        x = rng_next(rng);
+        memcpy(&d->bytes[i], &x, 8);
+    }
+    x = rng_next(rng);
+    sim_put32(d, OFF_ARCH, (x & 15) ? arch->audit_arch : (uint32_t)(x >> 32));
+    x = rng_next(rng);
+    switch (x & 7) {
+    case 0:
+        nr = (uint32_t)(x >> 32);
+        break;
+    case 1:
+        nr = (uint32_t)(x >> 32) % (arch_max_nr(arch) + 64);
+        break;
+    case 2:
+    case 3:
+    case 4:
+        nr = pol->n_rules ? (uint32_t)pol->rules[(x >> 32) % (uint64_t)pol->n_rules].nr : (uint32_t)(x >> 40);
+        break;
+    case 5:
+        nr = pol->n_hot ? (uint32_t)pol->hot[(x >> 32) % (uint64_t)pol->n_hot] : (uint32_t)(x >> 40);
+        nr += (uint32_t)((x >> 8) % 3) - 1;
+        break;
+    case 6:
+        nr = pol->n_rules ? (uint32_t)pol->rules[(x >> 32) % (uint64_t)pol->n_rules].nr : 0;
+        nr += (x & 8) ? 1 : (uint32_t)-1;
+        break;
+    default:
+        nr = edges[(x >> 32) % TABLE_LEN(edges)];
+        if (x & 8) {
+            nr |= X32_SYSCALL_BIT | (uint32_t)(x >> 48) % (arch_max_nr(arch) + 1);
+        }
+        break;
+    }
+    sim_put32(d, OFF_NR, nr);
+
+    r = find_rule(pol, (int)nr);
+    x = rng_next(rng);
+    if (r && r->arg != ARG_NONE && (x & 3)) {
+        uint32_t v = r->values[(x >> 32) % (uint64_t)r->n_values].value;
+        if (x & 4) {
+            v += (uint32_t)((x >> 8) % 3) - 1;  /* a neighbour of a matched value */
+        }
+        sim_put32(d, OFF_ARG_LO(arch, r->arg), v);
+    }
+}
+
+/* Returns the number of cases where the program disagrees with the policy */
+static unsigned long fuzz_prog(const struct prog *p, const struct arch_info *arch, const struct policy *pol,
+                               unsigned long cases, uint64_t seed) {
+    struct sim_data d;
+    unsigned long i, mismatches = 0;
+    uint64_t rng = seed ? seed : 1;
+    uint32_t got, want;
+    size_t steps, total_steps = 0;
+    clock_t start = clock();
+    double elapsed;
+    char gbuf[32], wbuf[32];
+
+    for (i = 0; i < cases; i++) {
+        fuzz_case(arch, pol, &rng, &d);
+        got = bpf_run(p, &d, &steps, NULL);
+        want = reference_action(arch, pol, &d);
+        total_steps += steps;
+        if (got != want && mismatches++ < 5) {
+            fprintf(stderr, "Mismatch: arch=0x%08x nr=%u args[0..5].lo=%08x %08x %08x %08x %08x %08x: got %s, want %s\n",
+                    sim_get32(&d, OFF_ARCH), sim_get32(&d, OFF_NR), sim_get32(&d, OFF_ARG_LO(arch, 0)),
+                    sim_get32(&d, OFF_ARG_LO(arch, 1)), sim_get32(&d, OFF_ARG_LO(arch, 2)),
+                    sim_get32(&d, OFF_ARG_LO(arch, 3)), sim_get32(&d, OFF_ARG_LO(arch, 4)),
+                    sim_get32(&d, OFF_ARG_LO(arch, 5)), action_name(got, gbuf, sizeof(gbuf)),
+                    action_name(want, wbuf, sizeof(wbuf)));
+        }
+    }
+    elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("  Fuzz:            %lu cases, %lu mismatches, %.2fs (%.1fM cases/s, %.1f insns/case)\n", cases,
+           mismatches, elapsed, elapsed > 0 ? (double)cases / elapsed / 1e6 : 0.0,
+           cases ? (double)total_steps / (double)cases : 0.0);
+    return mismatches;
+}
+
+static int read_file(const char *path, uint8_t **buf, size_t *len) {
+    FILE *fp = fopen(path, "rb");
+    size_t cap = 4096, n = 0, got;
+
+    if (!fp) {
+        fprintf(stderr, "Error: Cannot open '%s': %s\n", path, strerror(errno));
+        return 1;
+    }
+    *buf = malloc(cap);
+    while (*buf && (got = fread(*buf + n, 1, cap - n, fp)) > 0) {
+        n += got;
+        if (n == cap) {
+            cap *= 2;
+            *buf = realloc(*buf, cap);
+        }
+    }
+    fclose(fp);
+    if (!*buf) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+    *len = n;
+    return 0;
+}
+
+/*
+ * Keep only the notify rules (for --supervise) or everything else (for
+ * the bwrap filter). Returns the number of rules or values dropped.
+ */
+static int select_rules(struct policy *pol, int notify) {
+    int i, j, kept, n = 0, dropped = 0;
+
+    for (i = 0; i < pol->n_rules; i++) {
+        struct rule *r = &pol->rules[i];
+        if (r->arg == ARG_NONE) {
+            if ((r->action == RET_NOTIFY) != notify) {
+                dropped++;
+                continue;
+            }
+        } else {
+            for (j = kept = 0; j < r->n_values; j++) {
+                if ((r->values[j].action == RET_NOTIFY) == notify) {
+                    r->values[kept++] = r->values[j];
+                } else {
+                    dropped++;
+                }
+            }
+            r->n_values = kept;
+            if (kept == 0) {
+                continue;
+            }
+        }
+        if (n != i) {
+            pol->rules[n] = *r;
+        }
+        n++;
+    }
+    pol->n_rules = n;
+    return dropped;
+}
+
+/* Add "notify <syscall>" rules from a comma-separated list */
+static int add_notify_list(const struct arch_info *arch, struct policy *pol, const char *list) {
+    char line[128];
+    size_t len;
+    int n = 0;
+
+    /* Not strtok(): parse_policy_line() uses it on each generated line */
+    while (*list) {
+        len = strcspn(list, ", ");
+        if (len > 0) {
+            snprintf(line, sizeof(line), "notify %.*s", (int)len, list);
+            if (parse_policy_line(arch, pol, line, "--notify", ++n) != 0) {
+                return -1;
+            }
+        }
+        list += len + (list[len] ? 1 : 0);
+    }
+    return 0;
+}
+
+/*
+ * Load the policy for one architecture and compile it. With supervise set
+ * only the notify rules are compiled (plus notify_list, or the built-in
+ * notify set if the policy has none); otherwise they are left out.
+ */
+static int build_filter(const struct arch_info *arch, const char *policy_path, const char *hot_list,
+                        const char *notify_list, int supervise, struct policy *pol, struct prog *out) {
+    int dropped;
+
+    memset(pol, 0, sizeof(*pol));
+    if (policy_path) {
+        if (load_policy_file(arch, pol, policy_path) != 0) {
+            return 1;
+        }
+    } else if (!supervise && load_default_policy(arch, pol) != 0) {
+        return 1;
+    }
+    dropped = select_rules(pol, supervise);
+    if (supervise) {
+        if ((notify_list || pol->n_rules == 0) &&
+            add_notify_list(arch, pol, notify_list ? notify_list : default_notify_set) != 0) {
+            return 1;
+        }
+    } else if (dropped) {
+        fprintf(stderr, "Note: %d notify rule(s) left out of the %s filter; they apply under --supervise\n",
+                dropped, arch->name);
+    }
+    if (hot_list || !pol->hot_given) {
+        if (set_hot_list(arch, pol, hot_list ? hot_list : default_hot_set) != 0) {
+            return 1;
+        }
+    }
+    compile_policy(out, arch, pol);
+    if (verify_prog(out) != 0) {
+        fprintf(stderr, "Error: generated %s program failed verification\n", arch->name);
+        return 1;
+    }
+    return 0;
+}
+
+static int write_bundle(const char *output, const char *policy_path, const char *hot_list,
+                        unsigned long fuzz_cases, uint64_t seed) {
+    static struct policy pol;
+    uint8_t *bundle, *blob;
+    size_t i, len, offset = BUNDLE_HEADER_SIZE;
+    int hlen;
+    char header[BUNDLE_HEADER_SIZE];
+    int rc;
+
+    bundle = calloc(1, BUNDLE_HEADER_SIZE);
+    if (!bundle) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+    hlen = snprintf(header, sizeof(header), "%s\n", BUNDLE_MAGIC);
+    printf("Generating seccomp BPF bundle for %s\n", policy_path ? policy_path : "TIOCSTI/TIOCLINUX blocking");
+
+    for (i = 0; i < TABLE_LEN(arches); i++) {
+        struct prog prog = { 0 };
+        if (build_filter(&arches[i], policy_path, hot_list, NULL, 0, &pol, &prog) != 0) {
+            free(bundle);
+            return 1;
+        }
+        len = encode_prog(&arches[i], &prog, &blob);
+        hlen += snprintf(header + hlen, sizeof(header) - (size_t)hlen, "%s %zu %zu %u\n", arches[i].name,
+                         offset, prog.len, posix_cksum(blob, len));
+        printf("  %-8s %4zu instructions at offset %zu\n", arches[i].name, prog.len, offset);
+        if (fuzz_cases && fuzz_prog(&prog, &arches[i], &pol, fuzz_cases, seed) != 0) {
+            free(bundle);
+            return 1;
+        }
+
+        bundle = realloc(bundle, offset + len);
+        if (!bundle) {
+            fprintf(stderr, "Error: out of memory\n");
+            return 1;
+        }
+        memcpy(bundle + offset, blob, len);
+        offset += len;
+        free(blob);
+        free(prog.insns);
+    }
+    hlen += snprintf(header + hlen, sizeof(header) - (size_t)hlen, "end\n");
+    if ((size_t)hlen >= sizeof(header)) {
+        fprintf(stderr, "Error: bundle header exceeds %d bytes\n", BUNDLE_HEADER_SIZE);
+        free(bundle);
+        return 1;
+    }
+    memcpy(bundle, header, (size_t)hlen);
+
+    rc = write_file(output, bundle, offset);
+    free(bundle);
+    if (rc == 0) {
+        printf("Successfully wrote %zu-byte bundle to: %s\n", offset, output);
+    }
+    return rc;
+}
+
+/*
+ * =============================================================================
+ * SUPERVISOR (--supervise, Linux only)
+ * =============================================================================
+ *
+ * Rules with the "notify" action are audited rather than blocked. bwrap
+ * loads its filter with prctl() and cannot hand out a listener fd, so
+ * --supervise compiles the notify rules into a second filter, installs it
+ * with SECCOMP_FILTER_FLAG_NEW_LISTENER in a forked child, and the child
+ * passes the listener back over a socketpair before exec'ing the command
+ * (normally bwrap). The parent logs each notification and replies with
+ * SECCOMP_USER_NOTIF_FLAG_CONTINUE, so the syscall then runs as usual and
+ * everything outside the notify set never leaves the kernel.
+ *
+ * This is an audit trail, not an enforcement point: arguments are read
+ * from the target's memory and can change after they are logged. Log
+ * lines are batched and written when the buffer fills, after
+ * AUDIT_FLUSH_MS without a notification, and at exit. The supervisor
+ * keeps serving until the listener reports POLLHUP, when no task is left
+ * under the filter: processes the command leaves behind are audited too.
+ *
+ * Requires Linux 5.5+. If the listener cannot be set up the command runs
+ * unsupervised after a warning; the bwrap filter protects it regardless.
+ * Installing the filter needs no_new_privs, which stops a setuid (or
+ * file-capability) bwrap from gaining the privileges it runs on, so such
+ * a command is refused up front rather than run differently.
+ */
+#ifdef __linux__
+
+#include <arpa/inet.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+#include <sys/xattr.h>
+
+/* From linux/seccomp.h and linux/prctl.h */
+#define SECCOMP_SET_MODE_FILTER          1
+#define SECCOMP_FILTER_FLAG_NEW_LISTENER (1U << 3)
+#define SECCOMP_USER_NOTIF_FLAG_CONTINUE (1U << 0)
+#define PR_SET_NO_NEW_PRIVS_ARG          38
+
+/* _IOWR('!', 0, struct seccomp_notif), _IOWR('!', 1, ..._resp), _IOW('!', 2, __u64) */
+#define SECCOMP_IOCTL_NOTIF_RECV         0xc0502100UL
+#define SECCOMP_IOCTL_NOTIF_SEND         0xc0182101UL
+#if defined(__powerpc__)
+#define SECCOMP_IOCTL_NOTIF_ID_VALID     0x80082102UL
+#else
+#define SECCOMP_IOCTL_NOTIF_ID_VALID     0x40082102UL
+#endif
+
+struct notif_seccomp_data {
+    int32_t nr;
+    uint32_t arch;
+    uint64_t instruction_pointer;
+    uint64_t args[6];
+};
+
+struct seccomp_notif {
+    uint64_t id;
+    uint32_t pid;
+    uint32_t flags;
+    struct notif_seccomp_data data;
+};
+
+struct seccomp_notif_resp {
+    uint64_t id;
+    int64_t val;
+    int32_t error;
+    uint32_t flags;
+};
+
+struct kernel_sock_fprog {
+    unsigned short len;
+    struct sock_filter *filter;
+};
+
+#define AUDIT_BATCH_SIZE 8192
+#define AUDIT_FLUSH_MS   200
+
+struct audit_log {
+    int fd;
+    size_t len;
+    unsigned long records;
+    char buf[AUDIT_BATCH_SIZE];
+};
+
+static volatile sig_atomic_t supervised_child = 0;
+
+static void forward_signal(int sig) {
+    if (supervised_child > 0) {
+        kill((pid_t)supervised_child, sig);
+    }
+}
+
+static void audit_flush(struct audit_log *log) {
+    size_t off = 0;
+    ssize_t n;
+
+    while (off < log->len) {
+        n = write(log->fd, log->buf + off, log->len - off);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;  /* Best effort: never stall the sandbox on a full disk */
+        }
+        off += (size_t)n;
+    }
+    log->len = 0;
+}
+
+static void audit_append(struct audit_log *log, const char *fmt, ...) {
+    va_list ap;
+    int n;
+
+    if (AUDIT_BATCH_SIZE - log->len < 1024) {
+        audit_flush(log);
+    }
+    va_start(ap, fmt);
+    n = vsnprintf(log->buf + log->len, AUDIT_BATCH_SIZE - log->len, fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        log->len += (size_t)n < AUDIT_BATCH_SIZE - log->len ? (size_t)n : AUDIT_BATCH_SIZE - log->len - 1;
+    }
+    log->records++;
+}
+
+static ssize_t read_remote(pid_t pid, uint64_t addr, void *buf, size_t len) {
+    struct iovec local = { buf, len };
+    struct iovec remote = { (void *)(uintptr_t)addr, len };
+    return process_vm_readv(pid, &local, 1, &remote, 1, 0);
+}
+
+/* Copy a NUL-terminated string from the target, quoting control bytes */
+static void remote_string(pid_t pid, uint64_t addr, char *out, size_t size) {
+    char raw[256];
+    ssize_t n = read_remote(pid, addr, raw, sizeof(raw) - 1);
+    size_t i, o = 0;
+
+    if (n <= 0) {
+        snprintf(out, size, "?");
+        return;
+    }
+    raw[n] = '\0';
+    for (i = 0; raw[i] && o + 5 < size; i++) {
+        unsigned char c = (unsigned char)raw[i];
+        if (c < 0x20 || c == 0x7f || c == '"' || c == '\\') {
+            o += (size_t)snprintf(out + o, size - o, "\\x%02x", c);
+        } else {
+            out[o++] = (char)c;
+        }
+    }
+    out[o] = '\0';
+}
+
+static void remote_sockaddr(pid_t pid, uint64_t addr, uint64_t len, char *out, size_t size) {
+    struct sockaddr_storage ss;
+    char host[INET6_ADDRSTRLEN];
+    size_t n = len < sizeof(ss) ? (size_t)len : sizeof(ss);
+
+    memset(&ss, 0, sizeof(ss));
+    if (n < sizeof(sa_family_t) || read_remote(pid, addr, &ss, n) != (ssize_t)n) {
+        snprintf(out, size, "?");
+    } else if (ss.ss_family == AF_INET) {
+        const struct sockaddr_in *in = (const struct sockaddr_in *)&ss;
+        inet_ntop(AF_INET, &in->sin_addr, host, sizeof(host));
+        snprintf(out, size, "%s:%u", host, ntohs(in->sin_port));
+    } else if (ss.ss_family == AF_INET6) {
+        const struct sockaddr_in6 *in6 = (const struct sockaddr_in6 *)&ss;
+        inet_ntop(AF_INET6, &in6->sin6_addr, host, sizeof(host));
+        snprintf(out, size, "[%s]:%u", host, ntohs(in6->sin6_port));
+    } else if (ss.ss_family == AF_UNIX) {
+        const struct sockaddr_un *un = (const struct sockaddr_un *)&ss;
+        snprintf(out, size, "unix:%s%.*s", un->sun_path[0] ? "" : "@",
+                 (int)sizeof(un->sun_path) - 1, un->sun_path + (un->sun_path[0] ? 0 : 1));
+    } else {
+        snprintf(out, size, "family=%u", ss.ss_family);
+    }
+}
+
+/* Receive, log and continue one notification */
+static void handle_notification(int listener, const struct arch_info *arch, struct audit_log *log) {
+    struct seccomp_notif req;
+    struct seccomp_notif_resp resp;
+    struct timespec ts;
+    const char *name;
+    char detail[512];
+
+    memset(&req, 0, sizeof(req));  /* NOTIF_RECV requires a zeroed buffer */
+    if (ioctl(listener, SECCOMP_IOCTL_NOTIF_RECV, &req) != 0) {
+        return;  /* EINTR, or the target died (ENOENT) */
+    }
+    name = syscall_name(arch, req.data.nr);
+    detail[0] = '\0';
+    if (strcmp(name, "execve") == 0) {
+        remote_string((pid_t)req.pid, req.data.args[0], detail, sizeof(detail));
+    } else if (strcmp(name, "execveat") == 0) {
+        remote_string((pid_t)req.pid, req.data.args[1], detail, sizeof(detail));
+    } else if (strcmp(name, "connect") == 0) {
+        remote_sockaddr((pid_t)req.pid, req.data.args[1], req.data.args[2], detail, sizeof(detail));
+    } else {
+        snprintf(detail, sizeof(detail), "0x%llx 0x%llx 0x%llx", (unsigned long long)req.data.args[0],
+                 (unsigned long long)req.data.args[1], (unsigned long long)req.data.args[2]);
+    }
+    /* The detail was read from live memory; only trust it if the call is still pending */
+    if (ioctl(listener, SECCOMP_IOCTL_NOTIF_ID_VALID, &req.id) != 0) {
+        snprintf(detail, sizeof(detail), "(exited)");
+    }
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    audit_append(log, "%lld.%03ld pid=%u %s \"%s\"\n", (long long)ts.tv_sec, ts.tv_nsec / 1000000L, req.pid,
+                 name, detail);
+
+    memset(&resp, 0, sizeof(resp));
+    resp.id = req.id;
+    resp.flags = SECCOMP_USER_NOTIF_FLAG_CONTINUE;
+    ioctl(listener, SECCOMP_IOCTL_NOTIF_SEND, &resp);
+}
+
+/*
+ * Whether NAME, looked up through PATH the way execvp() does, would gain
+ * privileges on exec: setuid or setgid to someone else, or file
+ * capabilities. no_new_privs would silently strip them.
+ */
+static int gains_privileges(const char *name, char *path, size_t size) {
+    const char *dirs = getenv("PATH"), *end;
+    struct stat st;
+    size_t len;
+
+    if (strchr(name, '/')) {
+        snprintf(path, size, "%s", name);
+    } else {
+        path[0] = '\0';
+        for (dirs = dirs ? dirs : "/usr/local/bin:/usr/bin:/bin"; *dirs; dirs = *end ? end + 1 : end) {
+            end = strchr(dirs, ':');
+            end = end ? end : dirs + strlen(dirs);
+            len = (size_t)(end - dirs);
+            snprintf(path, size, "%.*s/%s", (int)len, len ? dirs : ".", name);
+            if (access(path, X_OK) == 0) {
+                break;
+            }
+            path[0] = '\0';
+        }
+    }
+    if (!path[0] || stat(path, &st) != 0) {
+        return 0;
+    }
+    return ((st.st_mode & S_ISUID) && st.st_uid != geteuid()) ||
+           ((st.st_mode & S_ISGID) && st.st_gid != getegid()) ||
+           getxattr(path, "security.capability", NULL, 0) >= 0;
+}
+
+/* In the child: install the notify filter and return its listener fd */
+static int install_listener(const struct arch_info *arch, const struct prog *p) {
+    struct kernel_sock_fprog fprog;
+    int nr = lookup_syscall(arch, "seccomp");
+
+    fprog.len = (unsigned short)p->len;
+    fprog.filter = p->insns;
+    if (nr < 0 || prctl(PR_SET_NO_NEW_PRIVS_ARG, 1, 0, 0, 0) != 0) {
+        return -1;
+    }
+    return (int)syscall(nr, SECCOMP_SET_MODE_FILTER, SECCOMP_FILTER_FLAG_NEW_LISTENER, &fprog);
+}
+
+static int send_fd(int sock, int fd) {
+    char byte = fd >= 0 ? 'F' : 'N';
+    char control[CMSG_SPACE(sizeof(int))];
+    struct iovec iov = { &byte, 1 };
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (fd >= 0) {
+        memset(control, 0, sizeof(control));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+    return sendmsg(sock, &msg, 0) == 1 ? 0 : -1;
+}
+
+static int recv_fd(int sock) {
+    char byte = 0;
+    char control[CMSG_SPACE(sizeof(int))];
+    struct iovec iov = { &byte, 1 };
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    int fd = -1;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) != 1 || byte != 'F') {
+        return -1;
+    }
+    cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+        memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+    return fd;
+}
+
+/* Whether the listener reports POLLHUP once its last task is gone (5.9+) */
+static int listener_reports_hup(void) {
+    struct utsname u;
+    int major = 0, minor = 0;
+
+    if (uname(&u) != 0 || sscanf(u.release, "%d.%d", &major, &minor) != 2) {
+        return 0;
+    }
+    return major > 5 || (major == 5 && minor >= 9);
+}
+
+static int supervise(const char *log_path, const char *policy_path, const char *hot_list,
+                     const char *notify_list, char **command) {
+    static struct policy pol;
+    static struct audit_log log;
+    const struct arch_info *arch = find_arch(HOST_ARCH_NAME);
+    struct prog prog = { 0 };
+    struct sigaction sa;
+    struct pollfd pfd;
+    char path[PATH_MAX];
+    int sv[2], listener, status = 0, n, hup;
+    pid_t child;
+
+    if (!arch) {
+        fprintf(stderr, "Error: --supervise is not supported on this architecture\n");
+        return 1;
+    }
+    if (gains_privileges(command[0], path, sizeof(path))) {
+        fprintf(stderr, "Error: --supervise cannot run %s: it is setuid or has file capabilities, and the "
+                "audit filter's no_new_privs would stop it from gaining them. Use an unprivileged "
+                "bwrap (user namespaces) or run without the audit log.\n", path);
+        return 1;
+    }
+    if (build_filter(arch, policy_path, hot_list, notify_list, 1, &pol, &prog) != 0) {
+        return 1;
+    }
+    log.fd = open(log_path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (log.fd < 0) {
+        fprintf(stderr, "Error: Cannot open '%s': %s\n", log_path, strerror(errno));
+        return 1;
+    }
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) != 0) {
+        fprintf(stderr, "Error: socketpair: %s\n", strerror(errno));
+        return 1;
+    }
+
+    child = fork();
+    if (child < 0) {
+        fprintf(stderr, "Error: fork: %s\n", strerror(errno));
+        return 1;
+    }
+    if (child == 0) {
+        close(sv[0]);
+        listener = install_listener(arch, &prog);
+        if (send_fd(sv[1], listener) != 0) {
+            _exit(127);
+        }
+        if (listener >= 0) {
+            close(listener);
+        }
+        close(sv[1]);
+        execvp(command[0], command);
+        fprintf(stderr, "Error: exec %s: %s\n", command[0], strerror(errno));
+        _exit(127);
+    }
+
+    close(sv[1]);
+    supervised_child = child;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = SIG_IGN;
+    sigaction(SIGINT, &sa, NULL);   /* The terminal delivers these to the child too */
+    sigaction(SIGQUIT, &sa, NULL);
+    sa.sa_handler = forward_signal;
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGHUP, &sa, NULL);
+
+    listener = recv_fd(sv[0]);
+    close(sv[0]);
+    free(prog.insns);
+    if (listener < 0) {
+        fprintf(stderr, "Warning: seccomp user notification unavailable (needs Linux 5.5+); "
+                "running without an audit log\n");
+    }
+
+    hup = listener_reports_hup();
+    while (listener >= 0) {
+        pfd.fd = listener;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        n = poll(&pfd, 1, AUDIT_FLUSH_MS);
+        if (n > 0 && (pfd.revents & POLLIN)) {
+            handle_notification(listener, arch, &log);
+        } else if (n > 0) {
+            break;  /* POLLHUP: no task is left under the filter */
+        } else if (n == 0) {
+            audit_flush(&log);
+        }
+        /*
+         * The child is reaped as soon as it exits, since a zombie keeps the
+         * filter alive and POLLHUP would never come, but serving goes on for
+         * whatever it left running. Older kernels never report POLLHUP, so
+         * there the child's exit has to end the audit.
+         */
+        if (child > 0 && waitpid(child, &status, WNOHANG) == child) {
+            child = 0;
+            supervised_child = 0;
+            if (!hup) {
+                break;
+            }
+        }
+    }
+    audit_flush(&log);
+    close(log.fd);
+    while (child > 0 && waitpid(child, &status, 0) < 0 && errno == EINTR) {
+    }
+    if (WIFSIGNALED(status)) {
+        return 128 + WTERMSIG(status);
+    }
+    return WEXITSTATUS(status);
+}
+
+/*
+ * =============================================================================
+ * LAUNCHER (--launch, Linux only)
+ * =============================================================================
+ *
+ * `sandbox --launch-plan PLAN` saves the bwrap command it ran from a cached
+ * policy, along with what that command was derived from. `--launch PLAN
+ * sandbox [opts] command...` replays it without starting the sandbox
+ * script: if the sandbox options match the plan and every recorded input
+ * still holds, it puts the seccomp filter on fd 200 and execs bwrap with
+ * the saved arguments and the command. Otherwise it execs the sandbox
+ * command line unchanged, which rebuilds the policy and rewrites the plan.
+ * bwrap still sets up the namespaces and loads the filter.
+ *
+ * A plan is "cco-launch 1" followed by NUL-terminated records, each tagged
+ * by its first byte:
+ *   p<arg>         sandbox argv up to the command (argv[0] included)
+ *   v<NAME>=<val>  environment variable that must match (unset == empty)
+ *   c<dir>         physical working directory
+ *   m<path>        file that must not be newer than the plan
+ *   d/f/-<path>    path that must be a directory / a non-directory / missing
+ *   e<path>        path that must exist (overlays under the cache)
+ *   r<dir>         when run as root, dir must be group root (no setpriv step)
+ *   s<path>        seccomp filter for fd 200
+ *   a<arg>         bwrap argument
+ */
+
+#define LAUNCH_PLAN_MAGIC "cco-launch 1"
+#define LAUNCH_FILTER_FD  200
+
+static int timespec_newer(const struct timespec *a, const struct timespec *b) {
+    return a->tv_sec > b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec > b->tv_nsec);
+}
+
+/* Does one check record still hold? Non-check records always do. */
+static int plan_check(const char *rec, const struct stat *plan_st) {
+    const char *path = rec + 1, *eq, *value;
+    char name[256], cwd[PATH_MAX];
+    struct stat st;
+
+    switch (rec[0]) {
+    case 'v':
+        eq = strchr(path, '=');
+        if (!eq || (size_t)(eq - path) >= sizeof(name)) {
+            return 0;
+        }
+        memcpy(name, path, (size_t)(eq - path));
+        name[eq - path] = '\0';
+        value = getenv(name);
+        return strcmp(value ? value : "", eq + 1) == 0;
+    case 'c':
+        return getcwd(cwd, sizeof(cwd)) && strcmp(cwd, path) == 0;
+    case 'm':
+        return stat(path, &st) == 0 && !timespec_newer(&st.st_mtim, &plan_st->st_mtim);
+    case 'd':
+        return lstat(path, &st) == 0 && S_ISDIR(st.st_mode);
+    case 'f':
+        return lstat(path, &st) == 0 && !S_ISDIR(st.st_mode) && !S_ISLNK(st.st_mode);
+    case '-':
+        return lstat(path, &st) != 0 && errno == ENOENT;
+    case 'e':
+        return lstat(path, &st) == 0;
+    case 'r':
+        return getuid() != 0 || (stat(path, &st) == 0 && st.st_gid == 0);
+    case 'p':
+    case 's':
+    case 'a':
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Build the bwrap argv for COMMAND from the plan in BUF, or return NULL if
+ * the plan does not apply. *filter is set to the seccomp filter, if any.
+ */
+static char **plan_command(char *buf, size_t len, const struct stat *plan_st, char **command,
+                           const char **filter) {
+    char *rec, *end = buf + len, **out;
+    size_t nargs = 0, prefix = 0, n = 0, ncmd = 0;
+
+    if (len == 0 || buf[len - 1] != '\0' || strcmp(buf, LAUNCH_PLAN_MAGIC) != 0) {
+        return NULL;
+    }
+    for (rec = buf + strlen(buf) + 1; rec < end; rec += strlen(rec) + 1) {
+        if (!plan_check(rec, plan_st)) {
+            return NULL;
+        }
+        if (rec[0] == 'p') {
+            if (!command[prefix] || strcmp(command[prefix], rec + 1) != 0) {
+                return NULL;
+            }
+            prefix++;
+        } else if (rec[0] == 'a') {
+            nargs++;
+        } else if (rec[0] == 's') {
+            *filter = rec + 1;
+        }
+    }
+    while (command[prefix + ncmd]) {
+        ncmd++;
+    }
+    if (prefix == 0 || ncmd == 0) {
+        return NULL;
+    }
+
+    out = calloc(nargs + ncmd + 2, sizeof(*out));
+    if (!out) {
+        return NULL;
+    }
+    out[n++] = "bwrap";
+    for (rec = buf + strlen(buf) + 1; rec < end; rec += strlen(rec) + 1) {
+        if (rec[0] == 'a') {
+            out[n++] = rec + 1;
+        }
+    }
+    memcpy(&out[n], &command[prefix], ncmd * sizeof(*out));
+    return out;
+}
+
+static int launch(const char *plan_path, char **command) {
+    const char *filter = NULL;
+    struct stat plan_st;
+    uint8_t *buf = NULL;
+    size_t len = 0;
+    char **bwrap_argv = NULL;
+    int fd, plan_fd;
+
+    plan_fd = open(plan_path, O_RDONLY | O_CLOEXEC);
+    if (plan_fd >= 0 && fstat(plan_fd, &plan_st) == 0 && S_ISREG(plan_st.st_mode) &&
+        plan_st.st_uid == getuid() && !(plan_st.st_mode & 022) &&
+        (buf = malloc((size_t)plan_st.st_size + 1)) != NULL) {
+        ssize_t got;
+        while (len < (size_t)plan_st.st_size &&
+               ((got = read(plan_fd, buf + len, (size_t)plan_st.st_size - len)) > 0 ||
+                (got < 0 && errno == EINTR))) {
+            len += got > 0 ? (size_t)got : 0;
+        }
+        bwrap_argv = plan_command((char *)buf, len, &plan_st, command, &filter);
+    }
+    if (plan_fd >= 0) {
+        close(plan_fd);
+    }
+
+    if (bwrap_argv) {
+        fd = filter ? open(filter, O_RDONLY) : -1;
+        if (fd >= 0 && fd != LAUNCH_FILTER_FD) {
+            int dup_fd = dup2(fd, LAUNCH_FILTER_FD);
+            close(fd);
+            fd = dup_fd;
+        }
+        if (!filter || fd == LAUNCH_FILTER_FD) {
+            execvp(bwrap_argv[0], bwrap_argv);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+        free(bwrap_argv);
+    }
+    free(buf);
+
+    /* The plan is missing or stale: take the full path */
+    execv(command[0], command);
+    fprintf(stderr, "Error: exec %s: %s\n", command[0], strerror(errno));
+    return 127;
+}
+
+#endif /* __linux__ */
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "Usage: %s [--arch NAME] [--policy FILE] [--hot LIST] <output-file>\n", argv0);
+    fprintf(stderr, "       %s --analyze [--arch NAME] [--policy FILE] [--hot LIST] [output-file]\n", argv0);
+    fprintf(stderr, "       %s --bundle [--policy FILE] [--hot LIST] <output-file>\n", argv0);
+    fprintf(stderr, "       %s --verify FILE [--arch NAME] [--policy FILE] [--fuzz N] [--seed N]\n", argv0);
+    fprintf(stderr, "       %s --supervise LOG [--policy FILE] [--notify LIST] -- command [args...]\n", argv0);
+    fprintf(stderr, "       %s --launch PLAN /path/to/sandbox [options] command [args...]\n\n", argv0);
+    fprintf(stderr, "Generates a seccomp BPF filter that blocks TIOCSTI and TIOCLINUX ioctls.\n");
+    fprintf(stderr, "The output file can be used with bubblewrap's --seccomp option.\n\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --arch NAME     Target architecture (x86_64, aarch64, i386, arm, riscv64,\n");
+    fprintf(stderr, "                  ppc64le, s390x)\n");
+    fprintf(stderr, "                  Default: the architecture this binary was built for\n");
+    fprintf(stderr, "  --policy FILE   Compile rules from FILE instead of the built-in policy\n");
+    fprintf(stderr, "  --hot LIST      Comma-separated hot syscalls allowed first, or 'none'\n");
+    fprintf(stderr, "                  Default: %s\n", default_hot_set);
+    fprintf(stderr, "  --analyze       Report which syscalls the kernel (5.11+) can cache as\n");
+    fprintf(stderr, "                  constant ALLOW; exits 2 if a hot syscall is not cacheable\n");
+    fprintf(stderr, "  --bundle        Write the filters for every architecture into one indexed file\n");
+    fprintf(stderr, "  --verify FILE   Check an existing filter against the policy instead of compiling;\n");
+    fprintf(stderr, "                  runs a 1000000-case fuzz corpus unless --fuzz says otherwise\n");
+    fprintf(stderr, "  --fuzz N        Compare N synthetic seccomp_data cases against the policy\n");
+    fprintf(stderr, "  --seed N        Corpus seed (default 1)\n");
+    fprintf(stderr, "  --supervise LOG Run command under a USER_NOTIF filter for the policy's notify\n");
+    fprintf(stderr, "                  rules, logging each call to LOG (Linux 5.5+)\n");
+    fprintf(stderr, "  --notify LIST   Comma-separated syscalls to log under --supervise\n");
+    fprintf(stderr, "                  Default (if the policy has none): %s\n", default_notify_set);
+    fprintf(stderr, "  --launch PLAN   Exec bwrap from a plan saved by sandbox --launch-plan, or run\n");
+    fprintf(stderr, "                  the sandbox command itself if the plan is missing or stale\n\n");
+    fprintf(stderr, "Example:\n");
+    fprintf(stderr, "  %s /tmp/filter.bpf\n", argv0);
+    fprintf(stderr, "  bwrap --seccomp 3 3</tmp/filter.bpf --ro-bind / / /bin/sh\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *arch_name = HOST_ARCH_NAME;
+    const char *policy_path = NULL;
+    const char *hot_list = NULL;
+    const char *output = NULL;
+    const struct arch_info *arch;
+    static struct policy pol;
+    struct prog prog = { 0 };
+    const char *verify_path = NULL;
+    const char *supervise_log = NULL;
+    const char *notify_list = NULL;
+    char **command = NULL;
+    uint8_t *blob;
+    size_t len;
+    unsigned long fuzz_cases = 0;
+    uint64_t seed = 1;
+    int i, analyze = 0, bundle = 0, fuzz_given = 0, uncached_hot = 0;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--arch") == 0 && i + 1 < argc) {
+            arch_name = argv[++i];
+        } else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+            policy_path = argv[++i];
+        } else if (strcmp(argv[i], "--hot") == 0 && i + 1 < argc) {
+            hot_list = argv[++i];
+        } else if (strcmp(argv[i], "--analyze") == 0) {
+            analyze = 1;
+        } else if (strcmp(argv[i], "--bundle") == 0) {
+            bundle = 1;
+        } else if (strcmp(argv[i], "--verify") == 0 && i + 1 < argc) {
+            verify_path = argv[++i];
+        } else if (strcmp(argv[i], "--fuzz") == 0 && i + 1 < argc) {
+            fuzz_cases = strtoul(argv[++i], NULL, 0);
+            fuzz_given = 1;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--supervise") == 0 && i + 1 < argc) {
+            supervise_log = argv[++i];
+        } else if (strcmp(argv[i], "--notify") == 0 && i + 1 < argc) {
+            notify_list = argv[++i];
+        } else if (strcmp(argv[i], "--launch") == 0 && i + 2 < argc) {
+#ifdef __linux__
+            return launch(argv[i + 1], &argv[i + 2]);
+#else
+            fprintf(stderr, "Error: --launch requires Linux\n");
+            return 1;
+#endif
+        } else if (strcmp(argv[i], "--") == 0 && supervise_log) {
+            command = &argv[i + 1];
+            break;
+        } else if (argv[i][0] == '-' || output) {
+            usage(argv[0]);
+            return 1;
+        } else {
+            output = argv[i];
+        }
+    }
+    if (supervise_log) {
+        if (!command || !command[0] || output || bundle || verify_path) {
+            usage(argv[0]);
+            return 1;
+        }
+#ifdef __linux__
+        return supervise(supervise_log, policy_path, hot_list, notify_list, command);
+#else
+        fprintf(stderr, "Error: --supervise requires Linux\n");
+        return 1;
+#endif
+    }
+    if ((!output && !analyze && !verify_path) || (bundle && (analyze || verify_path || !output)) ||
+        (verify_path && output)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (bundle) {
+        return write_bundle(output, policy_path, hot_list, fuzz_cases, seed);
+    }
+
+    arch = find_arch(arch_name);
+    if (!arch) {
+        fprintf(stderr, "Error: Unsupported architecture '%s'. Supported: "
+                "x86_64, aarch64, i386, arm, riscv64, ppc64le, s390x\n",
+                arch_name ? arch_name : "(unknown host)");
+        return 1;
+    }
+    if (build_filter(arch, policy_path, hot_list, NULL, 0, &pol, &prog) != 0) {
+        return 1;
+    }
+
+    if (verify_path) {
+        /* Keep the parsed policy as the reference; check the file's program */
+        free(prog.insns);
+        memset(&prog, 0, sizeof(prog));
+        if (read_file(verify_path, &blob, &len) != 0) {
+            return 1;
+        }
+        if (decode_prog(arch, blob, len, &prog) != 0) {
+            fprintf(stderr, "Error: %s: size %zu is not a multiple of %d\n", verify_path, len, FILTER_INSN_SIZE);
+            free(blob);
+            return 1;
+        }
+        free(blob);
+        printf("Verifying %s against %s\n", verify_path, policy_path ? policy_path : "TIOCSTI/TIOCLINUX blocking");
+        printf("  Architecture:    %s\n", arch->name);
+        printf("  Instructions:    %zu\n", prog.len);
+        if (verify_prog(&prog) != 0) {
+            return 1;
+        }
+        printf("  Structure:       ok\n");
+        if (fuzz_prog(&prog, arch, &pol, fuzz_given ? fuzz_cases : 1000000UL, seed) != 0) {
+            return 1;
+        }
+        if (analyze) {
+            uncached_hot = print_cache_analysis(arch, &pol, &prog);
+        }
+        free(prog.insns);
+        return uncached_hot ? 2 : 0;
+    }
+
+    printf("Generating seccomp BPF filter for %s\n", policy_path ? policy_path : "TIOCSTI/TIOCLINUX blocking");
+    printf("  Architecture:    %s\n", arch->name);
+    printf("  Audit arch:      0x%08x\n", arch->audit_arch);
+    print_rules(arch, &pol);
+    if (arch->has_x32_abi) {
+        printf("  x32 ABI:         blocked\n");
+    }
+    printf("  Instructions:    %zu\n", prog.len);
+    printf("  Filter size:     %zu bytes\n", prog.len * FILTER_INSN_SIZE);
+    print_cost_report(arch, &pol, &prog);
+    if (fuzz_cases && fuzz_prog(&prog, arch, &pol, fuzz_cases, seed) != 0) {
+        return 1;
+    }
+    if (analyze) {
+        uncached_hot = print_cache_analysis(arch, &pol, &prog);
+        if (!output) {
+            free(prog.insns);
+            return uncached_hot ? 2 : 0;
+        }
+    }
+
+    len = encode_prog(arch, &prog, &blob);
+    free(prog.insns);
+    if (write_file(output, blob, len) != 0) {
+        free(blob);
+        return 1;
+    }
+    free(blob);
+    printf("Successfully wrote filter to: %s\n", output);
+
+    return uncached_hot ? 2 : 0;
+}
@@ -0,0 +1,158 @@
+#!/usr/bin/env bash
+# Micro-benchmark the seccomp filters the sandbox can load.
+# Linux-only: measures ns/syscall with each filter installed via prctl(),
+# against the same loop with no filter.
+#
+# Environment:
+#   SECCOMP_BENCH_ITERATIONS    syscalls per measurement (default 200000)
+#   SECCOMP_BENCH_MAX_OVERHEAD  fail if any filter adds more than this many
+#                               ns to getpid or read (default: report only)
+
+set -euo pipefail
+
+cd "$(dirname "$0")/.."
+
+if [[ "$(uname -s)" != "Linux" ]]; then
+	echo "SKIP: Seccomp benchmarks only run on Linux"
+	exit 0
+fi
+
+ITERATIONS="${SECCOMP_BENCH_ITERATIONS:-200000}"
+MAX_OVERHEAD="${SECCOMP_BENCH_MAX_OVERHEAD:-}"
+work_dir="$(mktemp -d "${TMPDIR:-/tmp}/cco-seccomp-bench.XXXXXX")"
+trap 'rm -rf "$work_dir"' EXIT
+
+# Runs each workload in a child so every filter starts from a clean process.
+# Prints "<getpid> <read> <ioctl-allowed> <ioctl-blocked>" in ns/syscall,
+# each the best of several rounds.
+cat >"$work_dir/bench.c" <<'EOF'
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#define TIOCSTI 0x5412
+#define ROUNDS 5
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double best(int which, int fd, long n) {
+    double min = 0;
+    char c;
+    int avail, r;
+    long i;
+    for (r = 0; r < ROUNDS; r++) {
+        double t = now_ns();
+        for (i = 0; i < n; i++) {
+            switch (which) {
+            case 0: syscall(SYS_getpid); break;
+            case 1: if (read(fd, &c, 1) >= 0) exit(3); break;
+            case 2: ioctl(fd, FIONREAD, &avail); break;
+            case 3: ioctl(fd, TIOCSTI, &c); break;
+            }
+        }
+        t = (now_ns() - t) / n;
+        if (r == 0 || t < min) min = t;
+    }
+    return min;
+}
+
+int main(int argc, char **argv) {
+    static struct sock_filter insns[4096];
+    struct sock_fprog prog;
+    long n = argc > 1 ? atol(argv[1]) : 200000;
+    int p[2], w;
+    char c = 'X';
+    FILE *fp;
+
+    if (argc > 2) {
+        if (!(fp = fopen(argv[2], "rb"))) {
+            perror(argv[2]);
+            return 2;
+        }
+        prog.len = (unsigned short)fread(insns, sizeof(insns[0]), 4096, fp);
+        prog.filter = insns;
+        fclose(fp);
+        if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) || prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog)) {
+            perror("seccomp");
+            return 2;
+        }
+        /* Sanity: the filter under test must actually block TIOCSTI */
+        if (ioctl(0, TIOCSTI, &c) == 0 || errno != EPERM) {
+            fprintf(stderr, "%s does not block TIOCSTI\n", argv[2]);
+            return 2;
+        }
+    }
+    if (pipe(p) || fcntl(p[0], F_SETFL, O_NONBLOCK)) {
+        perror("pipe");
+        return 2;
+    }
+    for (w = 0; w < 4; w++) {
+        printf("%s%.1f", w ? " " : "", best(w, p[0], n));
+    }
+    printf("\n");
+    return 0;
+}
+EOF
+cc -O2 -o "$work_dir/bench" "$work_dir/bench.c"
+cc -O2 -o "$work_dir/tiocsti_filter" seccomp/tiocsti_filter.c
+
+# Filters under test: what sandbox ships plus the policy variants
+arch="$(uname -m)"
+names=()
+files=()
+add_filter() {
+	names+=("$1")
+	files+=("$2")
+}
+if [[ -f "seccomp/tiocsti_filter_$arch.bpf" ]]; then
+	add_filter "legacy .bpf" "seccomp/tiocsti_filter_$arch.bpf"
+fi
+"$work_dir/tiocsti_filter" "$work_dir/default.bpf" >/dev/null
+add_filter "default" "$work_dir/default.bpf"
+"$work_dir/tiocsti_filter" --hot none "$work_dir/default-cold.bpf" >/dev/null
+add_filter "default --hot none" "$work_dir/default-cold.bpf"
+"$work_dir/tiocsti_filter" --policy seccomp/hardened.policy "$work_dir/hardened.bpf" >/dev/null 2>&1
+add_filter "hardened" "$work_dir/hardened.bpf"
+"$work_dir/tiocsti_filter" --policy seccomp/hardened.policy --hot none "$work_dir/hardened-cold.bpf" >/dev/null 2>&1
+add_filter "hardened --hot none" "$work_dir/hardened-cold.bpf"
+
+echo "=== Seccomp Filter Overhead (ns/syscall, best of 5 x $ITERATIONS) ==="
+echo "Architecture: $arch  Kernel: $(uname -r)"
+echo ""
+printf '%-22s %5s %9s %9s %9s %9s\n' "filter" "insns" "getpid" "read" "ioctl-ok" "ioctl-blk"
+
+read -r base_getpid base_read base_ok base_blk < <("$work_dir/bench" "$ITERATIONS")
+printf '%-22s %5s %9s %9s %9s %9s\n' "(none)" "-" "$base_getpid" "$base_read" "$base_ok" "$base_blk"
+
+over_budget=()
+for i in "${!names[@]}"; do
+	insns=$(($(wc -c <"${files[$i]}") / 8))
+	if ! result="$("$work_dir/bench" "$ITERATIONS" "${files[$i]}" 2>&1)"; then
+		echo "FAIL: ${names[$i]}: $result"
+		exit 1
+	fi
+	read -r getpid_ns read_ns ok_ns blk_ns <<<"$result"
+	printf '%-22s %5s %9s %9s %9s %9s\n' "${names[$i]}" "$insns" "$getpid_ns" "$read_ns" "$ok_ns" "$blk_ns"
+	if [[ -n "$MAX_OVERHEAD" ]] &&
+		awk -v a="$getpid_ns" -v b="$read_ns" -v ba="$base_getpid" -v bb="$base_read" -v m="$MAX_OVERHEAD" \
+			'BEGIN { exit !(a - ba > m || b - bb > m) }'; then
+		over_budget+=("${names[$i]}")
+	fi
+done
+
+if [[ ${#over_budget[@]} -gt 0 ]]; then
+	echo ""
+	echo "FAIL: overhead above ${MAX_OVERHEAD}ns: ${over_budget[*]}"
+	exit 1
+fi
@@ -0,0 +1,251 @@
+#!/usr/bin/env bash
+# End-to-end startup benchmark: time from invoking `cco shell true` until
+# it returns, for each backend this host has, cold and warm.
+#
+#   native (bwrap on Linux, Seatbelt on macOS)
+#     cold: empty XDG cache (no policy cache, launch plan or helpers)
+#     warm: shared cache primed by earlier runs
+#   docker
+#     cold: empty XDG cache (registry, shim and package caches rebuilt)
+#     warm: shared cache primed by earlier runs
+#   docker-persist
+#     cold: a new --persist container each run
+#     warm: re-entering one running --persist container
+#
+# p50/p95/p99 are written as JSON to tests/baselines/startup-<os>-<arch>.json
+# (one scenario per line, so a regression shows up as a diff in review),
+# and compared with the numbers already in that file.
+#
+# Environment:
+#   BENCH_STARTUP_RUNS            runs per scenario (default 20)
+#   BENCH_STARTUP_BACKENDS        space-separated subset of: native docker
+#                                 docker-persist (default: all available)
+#   BENCH_STARTUP_OUTPUT          results file (default: the baseline above)
+#   BENCH_STARTUP_MAX_REGRESSION  fail if any p50 is this many percent slower
+#                                 than the previous results (default: report only)
+
+set -euo pipefail
+
+cd "$(dirname "$0")/.."
+repo_dir="$PWD"
+CCO_BIN="$repo_dir/cco"
+
+RUNS="${BENCH_STARTUP_RUNS:-20}"
+MAX_REGRESSION="${BENCH_STARTUP_MAX_REGRESSION:-}"
+os="$(uname -s | tr '[:upper:]' '[:lower:]')"
+arch="$(uname -m)"
+OUTPUT="${BENCH_STARTUP_OUTPUT:-$repo_dir/tests/baselines/startup-$os-$arch.json}"
+
+if [[ ! "$RUNS" =~ ^[1-9][0-9]*$ ]]; then
+	echo "BENCH_STARTUP_RUNS must be a positive integer" >&2
+	exit 1
+fi
+
+work_dir="$(mktemp -d "${TMPDIR:-/tmp}/cco-startup-bench.XXXXXX")"
+project_dir="$work_dir/cco-bench-project"
+mkdir -p "$project_dir"
+
+cleanup() {
+	if [[ " ${backends[*]-} " == *" docker-persist "* ]]; then
+		remove_persist_containers ""
+	fi
+	chmod -R u+w "$work_dir" 2>/dev/null || true
+	rm -rf "$work_dir"
+}
+trap cleanup EXIT
+
+# Microseconds since the epoch (EPOCHREALTIME needs bash 5)
+now_us() {
+	if [[ -n "${EPOCHREALTIME:-}" ]]; then
+		local t="${EPOCHREALTIME/[.,]/}"
+		echo "$t"
+	else
+		perl -MTime::HiRes=time -e 'printf "%d\n", time() * 1000000'
+	fi
+}
+
+native_available() {
+	case "$os" in
+	linux) command -v bwrap >/dev/null 2>&1 ;;
+	darwin) command -v sandbox-exec >/dev/null 2>&1 ;;
+	*) return 1 ;;
+	esac
+}
+
+docker_available() {
+	command -v docker >/dev/null 2>&1 && docker info >/dev/null 2>&1
+}
+
+# Remove the benchmark's --persist containers and their state; with a
+# NAME only the container for that persist name
+remove_persist_containers() {
+	local match="cco-cco-bench-project*"
+	[[ -z "$1" ]] || match="$match-persist-$1-*"
+	docker ps -a --filter "label=cco.persist=1" --format '{{.Names}}' | while read -r container; do
+		# shellcheck disable=SC2053  # match is a glob
+		if [[ "$container" == $match ]]; then
+			docker rm -f "$container" >/dev/null 2>&1 || true
+			rm -rf "$HOME/.local/share/cco/persist/$container"
+		fi
+	done
+}
+
+# Run `cco shell true` once with the given cache dir and cco flags,
+# printing its wall time in microseconds
+time_launch() {
+	local cache_home="$1"
+	shift
+	local start end
+	start=$(now_us)
+	if ! (cd "$project_dir" && XDG_CACHE_HOME="$cache_home" "$CCO_BIN" "$@" shell true) \
+		>"$work_dir/last.log" 2>&1 </dev/null; then
+		echo "cco $* shell true failed:" >&2
+		sed 's/^/    /' "$work_dir/last.log" >&2
+		return 1
+	fi
+	end=$(now_us)
+	echo $((end - start))
+}
+
+# "<p50> <p95> <p99>" in ms (nearest rank) for the samples in FILE
+percentiles() {
+	sort -n "$1" | awk '
+		{ v[NR] = $1 }
+		function rank(p,   r) { r = int(p * NR / 100); if (r < p * NR / 100) r++; if (r < 1) r = 1; return v[r] }
+		END { printf "%.1f %.1f %.1f\n", rank(50) / 1000, rank(95) / 1000, rank(99) / 1000 }'
+}
+
+# Measure one scenario: NAME, then the cco flags. Cold runs get a fresh
+# cache each; warm runs share one cache primed by two runs (the native
+# backend saves its launch plan on the second).
+run_scenario() {
+	local name="$1"
+	shift
+	local mode="${name##*-}" samples="$work_dir/$name.samples" i cache t
+	: >"$samples"
+	if [[ "$mode" == warm ]]; then
+		cache="$work_dir/cache-$name"
+		time_launch "$cache" "$@" >/dev/null || return 1
+		time_launch "$cache" "$@" >/dev/null || return 1
+	fi
+	for ((i = 1; i <= RUNS; i++)); do
+		if [[ "$mode" == cold ]]; then
+			cache="$work_dir/cache-$name-$i"
+		fi
+		t=$(time_launch "$cache" "$@") || return 1
+		echo "$t" >>"$samples"
+	done
+	local p50 p95 p99
+	read -r p50 p95 p99 < <(percentiles "$samples")
+	results+=("$name $p50 $p95 $p99")
+	printf '  %-22s p50 %8.1f ms   p95 %8.1f ms   p99 %8.1f ms\n' "$name" "$p50" "$p95" "$p99"
+}
+
+# Persist scenarios need their own container per cold run
+run_persist_scenario() {
+	local name="$1" samples="$work_dir/$name.samples" i t
+	: >"$samples"
+	if [[ "$name" == *-warm ]]; then
+		time_launch "$work_dir/cache-$name" --backend docker --persist bench-warm >/dev/null || return 1
+	fi
+	for ((i = 1; i <= RUNS; i++)); do
+		if [[ "$name" == *-cold ]]; then
+			t=$(time_launch "$work_dir/cache-$name-$i" --backend docker --persist "bench-cold-$i") || return 1
+			remove_persist_containers "bench-cold-$i"
+		else
+			t=$(time_launch "$work_dir/cache-$name" --backend docker --persist bench-warm) || return 1
+		fi
+		echo "$t" >>"$samples"
+	done
+	local p50 p95 p99
+	read -r p50 p95 p99 < <(percentiles "$samples")
+	results+=("$name $p50 $p95 $p99")
+	printf '  %-22s p50 %8.1f ms   p95 %8.1f ms   p99 %8.1f ms\n' "$name" "$p50" "$p95" "$p99"
+}
+
+backends=()
+if [[ -n "${BENCH_STARTUP_BACKENDS:-}" ]]; then
+	read -ra backends <<<"$BENCH_STARTUP_BACKENDS"
+else
+	native_available && backends+=(native)
+	if docker_available; then
+		backends+=(docker docker-persist)
+	fi
+fi
+if [[ ${#backends[@]} -eq 0 ]]; then
+	echo "SKIP: no sandbox backend available (needs bwrap, sandbox-exec or Docker)"
+	exit 0
+fi
+
+native_name="bwrap"
+[[ "$os" != darwin ]] || native_name="seatbelt"
+
+echo "=== cco Startup Benchmark ==="
+echo "Platform: $(uname -s) ($arch), $RUNS runs per scenario"
+echo ""
+
+results=()
+for backend in "${backends[@]}"; do
+	case "$backend" in
+	native)
+		run_scenario "native-$native_name-cold" --backend native
+		run_scenario "native-$native_name-warm" --backend native
+		;;
+	docker)
+		run_scenario docker-cold --backend docker
+		run_scenario docker-warm --backend docker
+		;;
+	docker-persist)
+		run_persist_scenario docker-persist-cold
+		run_persist_scenario docker-persist-warm
+		;;
+	*)
+		echo "Unknown backend in BENCH_STARTUP_BACKENDS: $backend" >&2
+		exit 1
+		;;
+	esac
+done
+
+# Compare p50s with the previous results before replacing them
+echo ""
+regressed=false
+if [[ -f "$OUTPUT" ]]; then
+	echo "Change in p50 against $(basename "$OUTPUT"):"
+	for result in "${results[@]}"; do
+		read -r name p50 _ <<<"$result"
+		old=$(sed -n "s/^ *\"$name\": {\"p50_ms\": \([0-9.]*\),.*/\1/p" "$OUTPUT")
+		if [[ -z "$old" ]]; then
+			printf '  %-22s (new)\n' "$name"
+			continue
+		fi
+		change=$(awk -v new="$p50" -v old="$old" 'BEGIN { if (old > 0) printf "%+.1f", (new - old) * 100 / old; else print "+0.0" }')
+		printf '  %-22s %8.1f -> %8.1f ms (%s%%)\n' "$name" "$old" "$p50" "$change"
+		if [[ -n "$MAX_REGRESSION" ]] && awk -v c="$change" -v max="$MAX_REGRESSION" 'BEGIN { exit !(c > max) }'; then
+			regressed=true
+		fi
+	done
+	echo ""
+fi
+
+mkdir -p "$(dirname "$OUTPUT")"
+{
+	echo "{"
+	printf '  "platform": "%s-%s",\n' "$os" "$arch"
+	printf '  "runs": %s,\n' "$RUNS"
+	echo '  "scenarios": {'
+	for i in "${!results[@]}"; do
+		read -r name p50 p95 p99 <<<"${results[i]}"
+		sep=","
+		[[ $i -lt $((${#results[@]} - 1)) ]] || sep=""
+		printf '    "%s": {"p50_ms": %s, "p95_ms": %s, "p99_ms": %s}%s\n' "$name" "$p50" "$p95" "$p99" "$sep"
+	done
+	echo "  }"
+	echo "}"
+} >"$OUTPUT.tmp.$$"
+mv -f "$OUTPUT.tmp.$$" "$OUTPUT"
+echo "Wrote $OUTPUT"
+
+if [[ "$regressed" == true ]]; then
+	echo "FAIL: p50 regressed by more than ${MAX_REGRESSION}%" >&2
+	exit 1
+fi
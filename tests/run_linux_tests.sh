@@ -1,6 +1,7 @@
 #!/usr/bin/env bash
 # Run Linux sandbox tests in Docker (useful for testing Linux from macOS)
-# Usage: ./tests/run_linux_tests.sh
+# Usage: ./tests/run_linux_tests.sh          run the tests
+#        ./tests/run_linux_tests.sh bench    run the native bwrap startup benchmark
 
 set -euo pipefail
 
@@ -11,6 +12,20 @@ IMAGE_NAME="cco-test-linux"
 echo "Building test container..."
 docker build -t "$IMAGE_NAME" -f tests/Dockerfile.linux .
 
+if [[ "${1:-}" == "bench" ]]; then
+	echo ""
+	echo "Running native (bwrap) startup benchmark..."
+	docker run --rm --privileged \
+		-v "$(pwd):/cco" \
+		-w /cco \
+		-e BENCH_STARTUP_BACKENDS=native \
+		-e BENCH_STARTUP_RUNS \
+		-e BENCH_STARTUP_MAX_REGRESSION \
+		"$IMAGE_NAME" \
+		bash tests/bench_startup.sh
+	exit
+fi
+
 echo ""
 echo "Running cross-platform sandbox tests..."
 docker run --rm --privileged \
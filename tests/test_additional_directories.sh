@@ -197,7 +197,13 @@ eval "$(sed -n '
   /^resolve_path()/,/^}/p
   /^add_rw_path()/,/^}/p
   /^needs_claude_authentication()/,/^}/p
+  /^hash_string()/,/^}/p
+  /^settings_cache_file()/,/^}/p
+  /^file_signature()/,/^}/p
+  /^read_settings_cache()/,/^}/p
   /^load_additional_directories_from_settings()/,/^}/p
+  /^settings_directory_records()/,/^}/p
+  /^apply_settings_directory_records()/,/^}/p
 ' "$CCO_BIN")"
 
 additional_dirs=()
@@ -372,6 +378,32 @@ assert_contains "$TEST_ROOT/no_parser.log" \
 	"python3/jq not found" \
 	"missing parsers warning is surfaced"
 
+# The parsed entries are cached, so a repeat launch needs no parser until
+# the settings file changes
+CACHE_ONLY_BIN="$TEST_ROOT/cache-only-bin"
+build_tool_bin "$CACHE_ONLY_BIN" sed stat sha256sum shasum awk mkdir dirname mv rm
+# shellcheck disable=SC2016  # Intentional: expand inside the loader script, not in this shell.
+run_loader_case "parsed settings are cached" "$PROJ_DIR" "$TEST_HOME" "$PATH" "$TEST_ROOT/cache_fill.log" \
+	'load_additional_directories_from_settings'
+# shellcheck disable=SC2016  # Intentional: expand inside the loader script, not in this shell.
+run_loader_case "cached settings load without python3 or jq" "$PROJ_DIR" "$TEST_HOME" "$CACHE_ONLY_BIN" "$TEST_ROOT/cache_hit.log" \
+	'load_additional_directories_from_settings; printf "ADDED:%s\n" "${additional_dirs[@]}"'
+assert_contains "$TEST_ROOT/cache_hit.log" \
+	"ADDED:$EXTRA_DIR_A" \
+	"cached settings add the configured directory"
+assert_not_contains "$TEST_ROOT/cache_hit.log" \
+	"python3/jq not found" \
+	"cached settings skip the parsers"
+cat >"$PROJ_DIR/.claude/settings.local.json" <<EOF
+{"additionalDirectories": ["$EXTRA_DIR_A", "$EXTRA_DIR_B"]}
+EOF
+run_loader_case "edited settings are parsed again" "$PROJ_DIR" "$TEST_HOME" "$CACHE_ONLY_BIN" "$TEST_ROOT/cache_stale.log" \
+	'load_additional_directories_from_settings'
+assert_contains "$TEST_ROOT/cache_stale.log" \
+	"python3/jq not found" \
+	"editing settings invalidates the cache"
+rm -rf "${XDG_CACHE_HOME:-$TEST_HOME/.cache}/cco/settings"
+
 # shellcheck disable=SC2016  # Intentional: expand inside the loader script, not in this shell.
 run_loader_case "pi mode skips Claude settings loader" "$PROJ_DIR" "$TEST_HOME" "$NO_PARSER_BIN" "$TEST_ROOT/pi_mode_skip.log" \
 	'command_flag="pi"; shell_mode=false; if needs_claude_authentication; then load_additional_directories_from_settings; fi; printf "COUNT:%s\n" "${#additional_dirs[@]}"'
@@ -382,6 +414,65 @@ assert_not_contains "$TEST_ROOT/pi_mode_skip.log" \
 	"python3/jq not found" \
 	"pi mode skips parser warnings too"
 
+echo ""
+echo "--- Docker Mount Planning ---"
+
+# A stub docker records the run arguments, so this runs without a daemon
+STUB_DOCKER_BIN="$TEST_ROOT/stub-docker-bin"
+mkdir -p "$STUB_DOCKER_BIN" "$PROJ_DIR/nested"
+cat >"$STUB_DOCKER_BIN/docker" <<EOF
+#!/usr/bin/env bash
+if [[ "\$1" == "run" ]]; then
+	printf '%s\n' "\$@" >"$TEST_ROOT/docker_run_args"
+fi
+exit 0
+EOF
+chmod +x "$STUB_DOCKER_BIN/docker"
+cat >"$PROJ_DIR/.claude/settings.local.json" <<EOF
+{"additionalDirectories": ["$PROJ_DIR/nested", "$EXTRA_DIR_A", "$EXTRA_DIR_A"]}
+EOF
+echo "Test: nested and duplicate additional directories collapse (docker)"
+if (cd "$PROJ_DIR" && HOME="$TEST_HOME" PATH="$STUB_DOCKER_BIN:$PATH" CCO_POOL=0 \
+	"$CCO_BIN" --backend docker --claude-command "$FAKE_CLAUDE_BIN") >"$TEST_ROOT/mount_plan.log" 2>&1 &&
+	[[ -f "$TEST_ROOT/docker_run_args" ]]; then
+	assert_not_contains "$TEST_ROOT/docker_run_args" \
+		"$PROJ_DIR/nested:$PROJ_DIR/nested" \
+		"directory inside the workspace mount is not mounted again"
+	if [[ $(grep -c "^$EXTRA_DIR_A:" "$TEST_ROOT/docker_run_args") -eq 1 ]]; then
+		pass "duplicate directory is mounted once"
+	else
+		sed 's/^/    /' "$TEST_ROOT/docker_run_args"
+		fail "duplicate directory is mounted once"
+	fi
+else
+	sed 's/^/    /' "$TEST_ROOT/mount_plan.log"
+	fail "stubbed docker launch runs successfully"
+fi
+
+# A read-only or deny mount of a parent is added after the --add-dir
+# mounts, so a writable dir nested in it must keep its own mount
+mkdir -p "$PROJ_DIR/outer/inner"
+rm -f "$PROJ_DIR/.claude/settings.local.json"
+for parent_flag in --allow-readonly --deny-path; do
+	echo "Test: writable dir nested in $parent_flag keeps its mount (docker)"
+	rm -f "$TEST_ROOT/docker_run_args"
+	if (cd "$PROJ_DIR" && HOME="$TEST_HOME" PATH="$STUB_DOCKER_BIN:$PATH" CCO_POOL=0 \
+		"$CCO_BIN" --backend docker --add-dir "$PROJ_DIR/outer/inner" "$parent_flag" "$PROJ_DIR/outer" \
+		--claude-command "$FAKE_CLAUDE_BIN") >"$TEST_ROOT/nested_${parent_flag#--}.log" 2>&1 &&
+		[[ -f "$TEST_ROOT/docker_run_args" ]]; then
+		if grep -qx -- "$PROJ_DIR/outer/inner:$PROJ_DIR/outer/inner" "$TEST_ROOT/docker_run_args" &&
+			grep -q -- ":$PROJ_DIR/outer:ro$" "$TEST_ROOT/docker_run_args"; then
+			pass "writable dir nested in $parent_flag keeps its mount (docker)"
+		else
+			sed 's/^/    /' "$TEST_ROOT/docker_run_args"
+			fail "writable dir nested in $parent_flag keeps its mount (docker)"
+		fi
+	else
+		sed 's/^/    /' "$TEST_ROOT/nested_${parent_flag#--}.log"
+		fail "writable dir nested in $parent_flag runs successfully (docker)"
+	fi
+done
+
 echo ""
 echo "=== Results ==="
 echo "Passed: $PASSED"
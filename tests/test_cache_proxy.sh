@@ -0,0 +1,183 @@
+#!/usr/bin/env bash
+# Tests for --cache-proxy (shared caching HTTP proxy). The proxy runs for
+# real against a local upstream server; Docker is stubbed.
+
+set -euo pipefail
+
+cd "$(dirname "$0")/.."
+CCO_BIN="$PWD/cco"
+PROXY_BIN="$PWD/lib/cache_proxy.py"
+
+PASSED=0
+FAILED=0
+SKIPPED=0
+
+pass() {
+	echo "PASS: $1"
+	PASSED=$((PASSED + 1))
+}
+
+fail() {
+	echo "FAIL: $1"
+	FAILED=$((FAILED + 1))
+}
+
+skip() {
+	echo "SKIP: $1"
+	SKIPPED=$((SKIPPED + 1))
+}
+
+echo "=== Cache Proxy Tests ==="
+echo "Platform: $(uname -s) ($(uname -m))"
+echo ""
+
+if ! command -v python3 >/dev/null 2>&1 || ! command -v curl >/dev/null 2>&1; then
+	skip "cache proxy tests need python3 and curl"
+	echo ""
+	echo "=== Results ==="
+	echo "Passed: $PASSED"
+	echo "Failed: $FAILED"
+	echo "Skipped: $SKIPPED"
+	exit 0
+fi
+
+TEST_ROOT=$(mktemp -d)
+upstream_pid=""
+cleanup() {
+	[[ -z "$upstream_pid" ]] || kill "$upstream_pid" 2>/dev/null || true
+	local pid_file
+	for pid_file in "$TEST_ROOT"/proxy/pid "$TEST_ROOT"/cache/cco/proxy/pid; do
+		[[ ! -f "$pid_file" ]] || kill "$(cat "$pid_file")" 2>/dev/null || true
+	done
+	rm -rf "$TEST_ROOT"
+}
+trap cleanup EXIT
+
+wait_for_file() {
+	local tries=0
+	while [[ ! -s "$1" ]] && ((tries < 50)); do
+		sleep 0.1
+		tries=$((tries + 1))
+	done
+	[[ -s "$1" ]]
+}
+
+# Local upstream serving one artifact and one metadata file
+mkdir -p "$TEST_ROOT/upstream/pkg"
+head -c 200000 /dev/urandom >"$TEST_ROOT/upstream/pkg/demo-1.0.tgz"
+echo '{"name": "demo"}' >"$TEST_ROOT/upstream/pkg/demo.json"
+(cd "$TEST_ROOT/upstream" && exec python3 -m http.server 0 --bind 127.0.0.1) >"$TEST_ROOT/upstream.log" 2>&1 &
+upstream_pid=$!
+upstream_port=""
+for _ in $(seq 50); do
+	upstream_port=$(sed -n 's/.*port \([0-9][0-9]*\).*/\1/p' "$TEST_ROOT/upstream.log" | head -1)
+	[[ -z "$upstream_port" ]] || break
+	sleep 0.1
+done
+UPSTREAM="http://127.0.0.1:$upstream_port"
+
+python3 "$PROXY_BIN" --root "$TEST_ROOT/proxy" </dev/null >"$TEST_ROOT/proxy.log" 2>&1 &
+if ! wait_for_file "$TEST_ROOT/proxy/port" || [[ -z "$upstream_port" ]]; then
+	sed 's/^/    /' "$TEST_ROOT/proxy.log" "$TEST_ROOT/upstream.log"
+	fail "proxy and upstream start"
+	exit 1
+fi
+PROXY="http://127.0.0.1:$(cat "$TEST_ROOT/proxy/port")"
+
+fetch() {
+	curl -sf --noproxy '' -x "$PROXY" -D "$TEST_ROOT/headers" -o "$2" "$1"
+}
+
+echo "Test: artifacts are served from the store after the first fetch"
+if fetch "$UPSTREAM/pkg/demo-1.0.tgz" "$TEST_ROOT/first" && grep -qi '^X-Cache: MISS' "$TEST_ROOT/headers" &&
+	fetch "$UPSTREAM/pkg/demo-1.0.tgz" "$TEST_ROOT/second" && grep -qi '^X-Cache: HIT' "$TEST_ROOT/headers" &&
+	cmp -s "$TEST_ROOT/second" "$TEST_ROOT/upstream/pkg/demo-1.0.tgz"; then
+	pass "artifacts are served from the store after the first fetch"
+else
+	sed 's/^/    /' "$TEST_ROOT/headers"
+	fail "artifacts are served from the store after the first fetch"
+fi
+
+echo "Test: metadata is passed through uncached"
+if fetch "$UPSTREAM/pkg/demo.json" "$TEST_ROOT/meta" && ! grep -qi '^X-Cache' "$TEST_ROOT/headers" &&
+	grep -q demo "$TEST_ROOT/meta"; then
+	pass "metadata is passed through uncached"
+else
+	fail "metadata is passed through uncached"
+fi
+
+echo "Test: hits and misses are counted"
+if grep -qx 'hits 1' "$TEST_ROOT/proxy/stats" && grep -qx 'misses 1' "$TEST_ROOT/proxy/stats" &&
+	grep -qx 'passthrough 1' "$TEST_ROOT/proxy/stats" && grep -qx 'bytes_from_cache 200000' "$TEST_ROOT/proxy/stats"; then
+	pass "hits and misses are counted"
+else
+	sed 's/^/    /' "$TEST_ROOT/proxy/stats"
+	fail "hits and misses are counted"
+fi
+
+echo ""
+echo "Test: cco info shows the hit rate"
+mkdir -p "$TEST_ROOT/cache/cco" "$TEST_ROOT/home"
+cp -R "$TEST_ROOT/proxy" "$TEST_ROOT/cache/cco/proxy"
+rm -f "$TEST_ROOT/cache/cco/proxy/pid"
+if HOME="$TEST_ROOT/home" XDG_CACHE_HOME="$TEST_ROOT/cache" "$CCO_BIN" info >"$TEST_ROOT/info.log" 2>&1 &&
+	grep -q "Artifact requests: 2 (1 hits, 1 misses, 50% hit rate)" "$TEST_ROOT/info.log"; then
+	pass "cco info shows the hit rate"
+else
+	sed 's/^/    /' "$TEST_ROOT/info.log"
+	fail "cco info shows the hit rate"
+fi
+rm -rf "$TEST_ROOT/cache/cco/proxy"
+
+echo ""
+echo "Test: Docker sessions start the proxy and get its settings"
+STUB_BIN="$TEST_ROOT/bin"
+PROJ_DIR="$TEST_ROOT/project"
+mkdir -p "$STUB_BIN" "$PROJ_DIR" "$TEST_ROOT/home/.claude"
+cat >"$STUB_BIN/docker" <<EOF
+#!/usr/bin/env bash
+if [[ "\$1" == "run" ]]; then
+	printf '%s\n' "\$@" >"$TEST_ROOT/docker_run_args"
+fi
+[[ "\$1 \$2" != "network ls" ]] || echo host
+exit 0
+EOF
+chmod +x "$STUB_BIN/docker"
+if (cd "$PROJ_DIR" && env -u HTTP_PROXY -u HTTPS_PROXY -u http_proxy -u https_proxy \
+	HOME="$TEST_ROOT/home" XDG_CACHE_HOME="$TEST_ROOT/cache" PATH="$STUB_BIN:$PATH" \
+	"$CCO_BIN" --backend docker --cache-proxy --command true) >"$TEST_ROOT/launch.log" 2>&1; then
+	port=$(cat "$TEST_ROOT/cache/cco/proxy/port" 2>/dev/null || true)
+	if [[ -n "$port" ]] && grep -qx "HTTPS_PROXY=http://127.0.0.1:$port" "$TEST_ROOT/docker_run_args" &&
+		grep -qx "npm_config_registry=http://127.0.0.1:$port/https/registry.npmjs.org/" "$TEST_ROOT/docker_run_args" &&
+		grep -qx "PIP_INDEX_URL=http://127.0.0.1:$port/https/pypi.org/simple/" "$TEST_ROOT/docker_run_args"; then
+		pass "Docker sessions start the proxy and get its settings"
+	else
+		sed 's/^/    /' "$TEST_ROOT/docker_run_args"
+		fail "Docker sessions start the proxy and get its settings"
+	fi
+else
+	sed 's/^/    /' "$TEST_ROOT/launch.log"
+	fail "Docker sessions start the proxy and get its settings"
+fi
+
+echo "Test: an existing HTTP(S)_PROXY is left alone"
+if (cd "$PROJ_DIR" && HTTPS_PROXY=http://corp.example:3128 HOME="$TEST_ROOT/home" \
+	XDG_CACHE_HOME="$TEST_ROOT/cache" PATH="$STUB_BIN:$PATH" \
+	"$CCO_BIN" --backend docker --cache-proxy --command true) >"$TEST_ROOT/existing.log" 2>&1 &&
+	grep -q "HTTP(S)_PROXY is already set" "$TEST_ROOT/existing.log" &&
+	! grep -q "npm_config_registry" "$TEST_ROOT/docker_run_args"; then
+	pass "an existing HTTP(S)_PROXY is left alone"
+else
+	sed 's/^/    /' "$TEST_ROOT/existing.log"
+	fail "an existing HTTP(S)_PROXY is left alone"
+fi
+
+echo ""
+echo "=== Results ==="
+echo "Passed: $PASSED"
+echo "Failed: $FAILED"
+echo "Skipped: $SKIPPED"
+
+if [[ $FAILED -gt 0 ]]; then
+	exit 1
+fi
@@ -0,0 +1,257 @@
+#!/usr/bin/env bash
+# Tests for `cco --fork N` copy-on-write workspaces.
+# Covers diff collection from overlay upper dirs and the Docker fan-out
+# (with a stub docker, so no daemon or overlay mount is needed).
+# shellcheck disable=SC1090
+
+set -euo pipefail
+
+cd "$(dirname "$0")/.."
+CCO_BIN="$PWD/cco"
+
+PASSED=0
+FAILED=0
+SKIPPED=0
+
+pass() {
+	echo "PASS: $1"
+	PASSED=$((PASSED + 1))
+}
+
+fail() {
+	echo "FAIL: $1"
+	FAILED=$((FAILED + 1))
+}
+
+skip() {
+	echo "SKIP: $1"
+	SKIPPED=$((SKIPPED + 1))
+}
+
+echo "=== Fork Workspace Tests ==="
+echo "Platform: $(uname -s) ($(uname -m))"
+echo ""
+
+if [[ "$(uname -s)" != "Linux" ]]; then
+	skip "Fork workspaces (Linux only)"
+	echo ""
+	echo "=== Results ==="
+	echo "Passed: $PASSED"
+	echo "Failed: $FAILED"
+	echo "Skipped: $SKIPPED"
+	exit 0
+fi
+
+TEST_ROOT=$(mktemp -d)
+trap 'rm -rf "$TEST_ROOT"' EXIT
+
+FUNCTIONS_ONLY="$TEST_ROOT/cco_functions.sh"
+sed '/^# Initialize variables$/q' "$CCO_BIN" >"$FUNCTIONS_ONLY"
+
+echo "Test: fork diffs cover changed, new and deleted files"
+lower="$TEST_ROOT/lower"
+upper="$TEST_ROOT/upper"
+mkdir -p "$lower/old" "$lower/.git" "$upper/.git"
+printf 'one\n' >"$lower/a.txt"
+printf 'gone\n' >"$lower/gone.txt"
+printf 'x\n' >"$lower/old/x.txt"
+printf 'one\ntwo\n' >"$upper/a.txt"
+printf 'new\n' >"$upper/new.txt"
+printf 'index\n' >"$upper/.git/index"
+whiteouts=true
+if ! mknod "$upper/gone.txt" c 0 0 2>/dev/null || ! mknod "$upper/old" c 0 0 2>/dev/null; then
+	whiteouts=false
+fi
+TEST_ROOT="$TEST_ROOT" FUNCTIONS_ONLY="$FUNCTIONS_ONLY" bash <<'EOF'
+set -euo pipefail
+source "$FUNCTIONS_ONLY"
+collect_fork_diff "$TEST_ROOT/upper" "$TEST_ROOT/lower" "$TEST_ROOT/fork.diff"
+EOF
+applied="$TEST_ROOT/applied"
+cp -R "$lower" "$applied"
+if (cd "$applied" && patch -p1 -s <"$TEST_ROOT/fork.diff") &&
+	[[ "$(cat "$applied/a.txt")" == $'one\ntwo' && "$(cat "$applied/new.txt")" == "new" ]]; then
+	pass "fork diff applies changed and new files"
+else
+	sed 's/^/    /' "$TEST_ROOT/fork.diff"
+	fail "fork diff applies changed and new files"
+fi
+if ! grep -q '\.git/' "$TEST_ROOT/fork.diff"; then
+	pass "fork diff leaves .git out"
+else
+	fail "fork diff leaves .git out"
+fi
+if [[ "$whiteouts" == true ]]; then
+	if [[ ! -e "$applied/gone.txt" && ! -e "$applied/old/x.txt" ]]; then
+		pass "whiteouts become deletions"
+	else
+		fail "whiteouts become deletions"
+	fi
+else
+	skip "whiteouts become deletions (mknod not permitted)"
+fi
+
+echo ""
+echo "Test: fork diffs cover symlinks, empty dirs and recreated dirs"
+lower="$TEST_ROOT/lower2"
+upper="$TEST_ROOT/upper2"
+mkdir -p "$lower/redo" "$lower/keep" "$upper/redo" "$upper/fresh/empty"
+printf 'old\n' >"$lower/redo/old.txt"
+printf 'same\n' >"$lower/redo/same.txt"
+printf 'k\n' >"$lower/keep/k.txt"
+ln -s keep/k.txt "$lower/moved-link"
+printf 'same\n' >"$upper/redo/same.txt"
+ln -s keep/k.txt "$upper/link"
+ln -s redo/same.txt "$upper/moved-link"
+opaque=true
+if ! python3 -c 'import os, sys; os.setxattr(sys.argv[1], "user.overlay.opaque", b"y")' "$upper/redo" 2>/dev/null; then
+	opaque=false
+fi
+if output=$(
+	TEST_ROOT="$TEST_ROOT" FUNCTIONS_ONLY="$FUNCTIONS_ONLY" bash <<'EOF' 2>&1
+set -euo pipefail
+source "$FUNCTIONS_ONLY"
+collect_fork_diff "$TEST_ROOT/upper2" "$TEST_ROOT/lower2" "$TEST_ROOT/fork2.diff"
+EOF
+); then
+	applied="$TEST_ROOT/applied2"
+	cp -R "$lower" "$applied"
+	if (cd "$applied" && git apply "$TEST_ROOT/fork2.diff") &&
+		[[ "$(readlink "$applied/link")" == "keep/k.txt" && "$(readlink "$applied/moved-link")" == "redo/same.txt" ]]; then
+		pass "fork diff carries new and retargeted symlinks"
+	else
+		sed 's/^/    /' "$TEST_ROOT/fork2.diff"
+		fail "fork diff carries new and retargeted symlinks"
+	fi
+	if grep -qx '# new empty directory: fresh/empty' "$TEST_ROOT/fork2.diff"; then
+		pass "fork diff lists new empty dirs"
+	else
+		sed 's/^/    /' "$TEST_ROOT/fork2.diff"
+		fail "fork diff lists new empty dirs"
+	fi
+	if [[ "$opaque" == true ]]; then
+		if [[ ! -e "$applied/redo/old.txt" && "$(cat "$applied/redo/same.txt")" == "same" && -f "$applied/keep/k.txt" ]]; then
+			pass "an opaque dir deletes what it hid"
+		else
+			sed 's/^/    /' "$TEST_ROOT/fork2.diff"
+			fail "an opaque dir deletes what it hid"
+		fi
+	else
+		skip "an opaque dir deletes what it hid (user xattrs not supported)"
+	fi
+else
+	printf '%s\n' "$output" | sed 's/^/    /'
+	fail "fork diffs cover symlinks, empty dirs and recreated dirs"
+fi
+
+echo ""
+echo "Test: --fork N runs N Docker sessions on their own overlay volumes"
+# The stub stands in for the daemon's overlay mount: each run writes a
+# file into the upper dir its volume was created with.
+STUB_BIN="$TEST_ROOT/bin"
+PROJ_DIR="$TEST_ROOT/proj"
+mkdir -p "$STUB_BIN" "$PROJ_DIR" "$TEST_ROOT/home/.claude" "$TEST_ROOT/volumes"
+printf 'base\n' >"$PROJ_DIR/README"
+cat >"$STUB_BIN/docker" <<EOF
+#!/usr/bin/env bash
+echo "docker \$*" >>"$TEST_ROOT/calls"
+if [[ "\$1 \$2" == "volume create" ]]; then
+	for arg in "\$@"; do
+		case "\$arg" in
+		o=*) upper="\${arg#*upperdir=}"; upper="\${upper%%,*}" ;;
+		esac
+	done
+	echo "\$upper" >"$TEST_ROOT/volumes/\${*: -1}"
+elif [[ "\$1" == "run" ]]; then
+	while [[ \$# -gt 0 ]]; do
+		if [[ "\$1" == "-v" && "\$2" == *-workspace:* ]]; then
+			volume="\${2%%:*}"
+			echo "from \$volume" >"\$(cat "$TEST_ROOT/volumes/\$volume")/\${volume##*-fork-}.txt"
+		fi
+		shift
+	done
+fi
+exit 0
+EOF
+chmod +x "$STUB_BIN/docker"
+if output=$(cd "$PROJ_DIR" && HOME="$TEST_ROOT/home" XDG_CACHE_HOME="$TEST_ROOT/cache" PATH="$STUB_BIN:$PATH" CCO_POOL=0 \
+	"$CCO_BIN" --backend docker --fork 2 --command true 2>&1); then
+	fork_root=$(find "$TEST_ROOT/cache/cco/forks" -mindepth 1 -maxdepth 1 -type d)
+	if grep -q '^+++ b/1-workspace.txt' "$fork_root/1.diff" && grep -q '^+++ b/2-workspace.txt' "$fork_root/2.diff" &&
+		! grep -q '2-workspace' "$fork_root/1.diff"; then
+		pass "each fork's changes land in its own diff"
+	else
+		printf '%s\n' "$output" | sed 's/^/    /'
+		fail "each fork's changes land in its own diff"
+	fi
+	if [[ $(grep -c '^docker volume create' "$TEST_ROOT/calls") -eq 2 && $(grep -c '^docker volume rm' "$TEST_ROOT/calls") -eq 2 ]]; then
+		pass "overlay volumes are created and removed per fork"
+	else
+		sed 's/^/    /' "$TEST_ROOT/calls"
+		fail "overlay volumes are created and removed per fork"
+	fi
+	if [[ "$(cat "$PROJ_DIR/README")" == "base" && -z "$(find "$PROJ_DIR" -name '*-workspace.txt')" ]]; then
+		pass "the shared workspace is left untouched"
+	else
+		fail "the shared workspace is left untouched"
+	fi
+else
+	printf '%s\n' "$output" | sed 's/^/    /'
+	fail "--fork N runs N Docker sessions on their own overlay volumes"
+fi
+
+echo ""
+echo "Test: --fork rejects persistent sessions"
+if output=$(cd "$PROJ_DIR" && HOME="$TEST_ROOT/home" PATH="$STUB_BIN:$PATH" \
+	"$CCO_BIN" --backend docker --fork 2 --persist --command true 2>&1); then
+	fail "--fork rejects persistent sessions"
+elif [[ "$output" == *"--fork cannot be combined"* ]]; then
+	pass "--fork rejects persistent sessions"
+else
+	printf '%s\n' "$output" | sed 's/^/    /'
+	fail "--fork rejects persistent sessions"
+fi
+
+echo ""
+echo "Test: --fork checks bubblewrap supports --overlay"
+cat >"$STUB_BIN/bwrap" <<'EOF'
+#!/usr/bin/env bash
+[[ "$1" == "--version" ]] && echo "bubblewrap 0.9.0"
+exit 0
+EOF
+chmod +x "$STUB_BIN/bwrap"
+if output=$(cd "$PROJ_DIR" && HOME="$TEST_ROOT/home" PATH="$STUB_BIN:$PATH" \
+	"$CCO_BIN" --backend native --fork 2 --command true 2>&1); then
+	fail "--fork checks bubblewrap supports --overlay"
+elif [[ "$output" == *"needs bubblewrap 0.10 or newer"*"bubblewrap 0.9.0"* ]]; then
+	pass "--fork checks bubblewrap supports --overlay"
+else
+	printf '%s\n' "$output" | sed 's/^/    /'
+	fail "--fork checks bubblewrap supports --overlay"
+fi
+
+echo ""
+echo "Test: --fork refuses a .git outside the forked directory"
+REPO_DIR="$TEST_ROOT/repo"
+git init -q "$REPO_DIR"
+git -C "$REPO_DIR" -c user.name=t -c user.email=t@t commit -q --allow-empty -m init
+git -C "$REPO_DIR" worktree add -q "$TEST_ROOT/wt" 2>/dev/null
+if output=$(cd "$TEST_ROOT/wt" && HOME="$TEST_ROOT/home" XDG_CACHE_HOME="$TEST_ROOT/cache" PATH="$STUB_BIN:$PATH" CCO_POOL=0 \
+	"$CCO_BIN" --backend docker --fork 2 --command true 2>&1); then
+	fail "--fork refuses a .git outside the forked directory"
+elif [[ "$output" == *"--fork would share a .git outside the forked directory"* ]]; then
+	pass "--fork refuses a .git outside the forked directory"
+else
+	printf '%s\n' "$output" | sed 's/^/    /'
+	fail "--fork refuses a .git outside the forked directory"
+fi
+
+echo ""
+echo "=== Results ==="
+echo "Passed: $PASSED"
+echo "Failed: $FAILED"
+echo "Skipped: $SKIPPED"
+
+if [[ $FAILED -gt 0 ]]; then
+	exit 1
+fi
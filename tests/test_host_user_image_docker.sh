@@ -0,0 +1,135 @@
+#!/usr/bin/env bash
+# Regression tests for the cached host-user Docker image.
+
+set -euo pipefail
+
+cd "$(dirname "$0")/.."
+
+CCO_BIN="$PWD/cco"
+
+PASSED=0
+FAILED=0
+SKIPPED=0
+
+pass() {
+	echo "PASS: $1"
+	PASSED=$((PASSED + 1))
+}
+
+fail() {
+	echo "FAIL: $1"
+	FAILED=$((FAILED + 1))
+}
+
+skip() {
+	echo "SKIP: $1"
+	SKIPPED=$((SKIPPED + 1))
+}
+
+assert_contains() {
+	local file="$1"
+	local expected="$2"
+	local name="$3"
+	if grep -Fq -- "$expected" "$file"; then
+		pass "$name"
+	else
+		echo "  expected to find: $expected"
+		echo "  output:"
+		sed 's/^/    /' "$file"
+		fail "$name"
+	fi
+}
+
+supports_docker() {
+	command -v docker >/dev/null 2>&1 && docker info >/dev/null 2>&1
+}
+
+echo "=== Docker Host-User Image Regression Tests ==="
+echo "Platform: $(uname -s) ($(uname -m))"
+echo ""
+
+if ! supports_docker; then
+	skip "docker backend unavailable"
+	echo ""
+	echo "=== Results ==="
+	echo "Passed: $PASSED"
+	echo "Failed: $FAILED"
+	echo "Skipped: $SKIPPED"
+	exit 0
+fi
+
+if [[ "$(id -u)" == "0" ]]; then
+	skip "host-user image is not used when running as root"
+	echo ""
+	echo "=== Results ==="
+	echo "Passed: $PASSED"
+	echo "Failed: $FAILED"
+	echo "Skipped: $SKIPPED"
+	exit 0
+fi
+
+TEST_ROOT=$(mktemp -d)
+TEST_HOME="$TEST_ROOT/home"
+TEST_WORKDIR="$TEST_ROOT/cco-host-user-test-$$"
+mkdir -p "$TEST_HOME" "$TEST_WORKDIR"
+trap 'rm -rf "$TEST_ROOT"' EXIT
+
+run_in_test_workdir() {
+	(
+		cd "$TEST_WORKDIR"
+		HOME="$TEST_HOME" "$CCO_BIN" "$@"
+	)
+}
+
+echo "Test: first session caches the host-user image"
+if run_in_test_workdir --backend docker --command sh -c 'id -u; printf "%s\n" "$HOME"' \
+	>"$TEST_ROOT/first.log" 2>&1; then
+	assert_contains "$TEST_ROOT/first.log" "$(id -u)" "session runs as the host UID"
+	assert_contains "$TEST_ROOT/first.log" "/home/hostuser" "session HOME is the container user home"
+	if docker image ls cco-hostuser --format '{{.Tag}}' | grep -q "^$(id -u)-$(id -g)-"; then
+		pass "host-user image is tagged per UID/GID"
+	else
+		fail "host-user image is tagged per UID/GID"
+	fi
+else
+	echo "  output:"
+	sed 's/^/    /' "$TEST_ROOT/first.log"
+	fail "first session succeeds"
+fi
+
+echo ""
+echo "Test: later sessions skip the entrypoint user setup"
+if run_in_test_workdir --backend docker --command true >"$TEST_ROOT/second.log" 2>&1; then
+	if grep -q "Setting up container user\|Caching container user" "$TEST_ROOT/second.log"; then
+		echo "  output:"
+		sed 's/^/    /' "$TEST_ROOT/second.log"
+		fail "cached image skips user setup"
+	else
+		pass "cached image skips user setup"
+	fi
+else
+	echo "  output:"
+	sed 's/^/    /' "$TEST_ROOT/second.log"
+	fail "second session succeeds"
+fi
+
+echo ""
+echo "Test: CCO_HOST_USER_IMAGE=0 falls back to per-start user setup"
+if (cd "$TEST_WORKDIR" && HOME="$TEST_HOME" CCO_HOST_USER_IMAGE=0 "$CCO_BIN" --backend docker --command true) \
+	>"$TEST_ROOT/fallback.log" 2>&1; then
+	assert_contains "$TEST_ROOT/fallback.log" "Setting up container user" "opt-out runs the entrypoint setup"
+else
+	echo "  output:"
+	sed 's/^/    /' "$TEST_ROOT/fallback.log"
+	fail "opt-out session succeeds"
+fi
+
+echo ""
+echo "=== Results ==="
+echo "Passed: $PASSED"
+echo "Failed: $FAILED"
+echo "Skipped: $SKIPPED"
+
+if [[ $FAILED -gt 0 ]]; then
+	exit 1
+fi
@@ -0,0 +1,175 @@
+#!/usr/bin/env bash
+# Tests for the package caches shared between sessions and backends.
+# Docker launches use a stub docker that records its run arguments.
+# shellcheck disable=SC1090
+
+set -euo pipefail
+
+cd "$(dirname "$0")/.."
+CCO_BIN="$PWD/cco"
+
+PASSED=0
+FAILED=0
+
+pass() {
+	echo "PASS: $1"
+	PASSED=$((PASSED + 1))
+}
+
+fail() {
+	echo "FAIL: $1"
+	FAILED=$((FAILED + 1))
+}
+
+assert_contains() {
+	local file="$1"
+	local expected="$2"
+	local name="$3"
+	if grep -Fxq -- "$expected" "$file"; then
+		pass "$name"
+	else
+		echo "  expected to find: $expected"
+		echo "  output:"
+		sed 's/^/    /' "$file"
+		fail "$name"
+	fi
+}
+
+echo "=== Package Cache Tests ==="
+echo "Platform: $(uname -s) ($(uname -m))"
+echo ""
+
+TEST_ROOT=$(mktemp -d)
+trap 'chmod -R u+w "$TEST_ROOT" 2>/dev/null; rm -rf "$TEST_ROOT"' EXIT
+
+FUNCTIONS_ONLY="$TEST_ROOT/cco_functions.sh"
+sed '/^# Initialize variables$/q' "$CCO_BIN" >"$FUNCTIONS_ONLY"
+
+STUB_BIN="$TEST_ROOT/bin"
+PROJ_DIR="$TEST_ROOT/project"
+CACHE_HOME="$TEST_ROOT/cache"
+mkdir -p "$STUB_BIN" "$PROJ_DIR" "$TEST_ROOT/home/.claude"
+cat >"$STUB_BIN/docker" <<EOF
+#!/usr/bin/env bash
+if [[ "\$1" == "run" ]]; then
+	printf '%s\n' "\$@" >"$TEST_ROOT/docker_run_args"
+fi
+exit 0
+EOF
+chmod +x "$STUB_BIN/docker"
+
+run_stub_docker() {
+	rm -f "$TEST_ROOT/docker_run_args"
+	(cd "$PROJ_DIR" && HOME="$TEST_ROOT/home" XDG_CACHE_HOME="$CACHE_HOME" PATH="$STUB_BIN:$PATH" CCO_POOL=0 \
+		"$CCO_BIN" --backend docker "$@" --command true) >"$TEST_ROOT/launch.log" 2>&1
+}
+
+echo "Test: Docker sessions mount the shared package caches"
+if run_stub_docker && [[ -f "$TEST_ROOT/docker_run_args" ]]; then
+	assert_contains "$TEST_ROOT/docker_run_args" "$CACHE_HOME/cco/packages/npm:/var/cache/cco/npm" "npm cache is mounted"
+	assert_contains "$TEST_ROOT/docker_run_args" "npm_config_cache=/var/cache/cco/npm" "npm is pointed at the mounted cache"
+	assert_contains "$TEST_ROOT/docker_run_args" "GOMODCACHE=/var/cache/cco/go-mod" "Go module cache is pointed at the mounted cache"
+	assert_contains "$TEST_ROOT/docker_run_args" "$CACHE_HOME/cco/packages/cargo-registry:/opt/cargo/registry" \
+		"cargo registry is mounted into CARGO_HOME"
+	if [[ $(find "$CACHE_HOME/cco/packages/.sessions" -type f | wc -l) -eq 1 ]]; then
+		pass "session is registered as a cache user"
+	else
+		fail "session is registered as a cache user"
+	fi
+else
+	sed 's/^/    /' "$TEST_ROOT/launch.log"
+	fail "stubbed docker launch runs successfully"
+fi
+
+echo "Test: CCO_PACKAGE_CACHE=0 leaves the caches out"
+if CCO_PACKAGE_CACHE=0 run_stub_docker && ! grep -q '/var/cache/cco/' "$TEST_ROOT/docker_run_args"; then
+	pass "CCO_PACKAGE_CACHE=0 leaves the caches out"
+else
+	fail "CCO_PACKAGE_CACHE=0 leaves the caches out"
+fi
+
+echo "Test: Persistent containers keep their own caches"
+if run_stub_docker --persist; then
+	if ! grep -q "shared package caches" "$TEST_ROOT/launch.log"; then
+		pass "Persistent containers keep their own caches"
+	else
+		fail "Persistent containers keep their own caches"
+	fi
+else
+	sed 's/^/    /' "$TEST_ROOT/launch.log"
+	fail "Persistent containers keep their own caches"
+fi
+
+echo ""
+echo "Test: Native sessions keep the caches users already chose"
+if output=$(
+	TEST_ROOT="$TEST_ROOT" FUNCTIONS_ONLY="$FUNCTIONS_ONLY" bash <<'EOF' 2>&1
+set -euo pipefail
+source "$FUNCTIONS_ONLY"
+XDG_CACHE_HOME="$TEST_ROOT/native"
+unset npm_config_cache GOMODCACHE GOCACHE PIP_CACHE_DIR UV_CACHE_DIR BUN_INSTALL_CACHE_DIR
+export GOCACHE="$TEST_ROOT/my-go-build"
+sandbox_rules=()
+use_native_package_caches
+echo "GOCACHE=$GOCACHE"
+echo "GOMODCACHE=$GOMODCACHE"
+echo "npm_config_cache=${npm_config_cache:-unset}"
+printf 'rule %s\n' "${sandbox_rules[@]}"
+EOF
+); then
+	printf '%s\n' "$output" >"$TEST_ROOT/native_caches"
+	assert_contains "$TEST_ROOT/native_caches" "GOCACHE=$TEST_ROOT/my-go-build" "a cache variable the user set is kept"
+	assert_contains "$TEST_ROOT/native_caches" "GOMODCACHE=$TEST_ROOT/native/cco/packages/go-mod" "unset cache variables point at the shared caches"
+	assert_contains "$TEST_ROOT/native_caches" "npm_config_cache=unset" "npm keeps its default ~/.npm"
+	if ! grep -q 'packages/go-build\|packages/npm' "$TEST_ROOT/native_caches"; then
+		pass "caches left on their own paths are not made writable"
+	else
+		sed 's/^/    /' "$TEST_ROOT/native_caches"
+		fail "caches left on their own paths are not made writable"
+	fi
+else
+	printf '%s\n' "$output" | sed 's/^/    /'
+	fail "Native sessions keep the caches users already chose"
+fi
+
+echo ""
+echo "Test: cleanup keeps caches while a session uses them"
+if output=$(
+	XDG_CACHE_HOME="$TEST_ROOT/cleanup" FUNCTIONS_ONLY="$FUNCTIONS_ONLY" bash <<'EOF' 2>&1
+set -euo pipefail
+source "$FUNCTIONS_ONLY"
+prepare_package_caches
+mkdir -p "$(package_cache_root)/go-mod/example.com/mod@v1"
+echo data >"$(package_cache_root)/go-mod/example.com/mod@v1/go.mod"
+chmod -R a-w "$(package_cache_root)/go-mod/example.com"
+# A live session (this shell) keeps them
+remove_package_caches
+[[ -f "$(package_cache_root)/go-mod/example.com/mod@v1/go.mod" ]] && echo "kept while in use"
+# Once the session is gone they are removed, read-only Go dirs included
+mv "$(package_cache_root)/.sessions/$$" "$(package_cache_root)/.sessions/999999999"
+remove_package_caches
+[[ ! -e "$(package_cache_root)/go-mod" ]] && echo "removed when idle"
+[[ ! -e "$(package_cache_root)/.lock" ]] && echo "lock released"
+EOF
+); then
+	for expected in "kept while in use" "removed when idle" "lock released"; do
+		if [[ "$output" == *"$expected"* ]]; then
+			pass "cleanup: $expected"
+		else
+			printf '%s\n' "$output" | sed 's/^/    /'
+			fail "cleanup: $expected"
+		fi
+	done
+else
+	printf '%s\n' "$output" | sed 's/^/    /'
+	fail "cleanup keeps caches while a session uses them"
+fi
+
+echo ""
+echo "=== Results ==="
+echo "Passed: $PASSED"
+echo "Failed: $FAILED"
+
+if [[ $FAILED -gt 0 ]]; then
+	exit 1
+fi
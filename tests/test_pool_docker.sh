@@ -0,0 +1,192 @@
+#!/usr/bin/env bash
+# Regression tests for the Docker warm container pool (`cco pool`).
+
+set -euo pipefail
+
+cd "$(dirname "$0")/.."
+
+CCO_BIN="$PWD/cco"
+
+PASSED=0
+FAILED=0
+SKIPPED=0
+
+pass() {
+	echo "PASS: $1"
+	PASSED=$((PASSED + 1))
+}
+
+fail() {
+	echo "FAIL: $1"
+	FAILED=$((FAILED + 1))
+}
+
+skip() {
+	echo "SKIP: $1"
+	SKIPPED=$((SKIPPED + 1))
+}
+
+assert_contains() {
+	local file="$1"
+	local expected="$2"
+	local name="$3"
+	if grep -Fq -- "$expected" "$file"; then
+		pass "$name"
+	else
+		echo "  expected to find: $expected"
+		echo "  output:"
+		sed 's/^/    /' "$file"
+		fail "$name"
+	fi
+}
+
+supports_docker() {
+	command -v docker >/dev/null 2>&1 && docker info >/dev/null 2>&1
+}
+
+hash_string() {
+	local input="$1"
+	if command -v sha256sum >/dev/null 2>&1; then
+		printf '%s' "$input" | sha256sum | awk '{print substr($1, 1, 12)}'
+	elif command -v shasum >/dev/null 2>&1; then
+		printf '%s' "$input" | shasum -a 256 | awk '{print substr($1, 1, 12)}'
+	else
+		printf '%s' "$input" | cksum | awk '{print $1}'
+	fi
+}
+
+echo "=== Docker Container Pool Regression Tests ==="
+echo "Platform: $(uname -s) ($(uname -m))"
+echo ""
+
+if ! supports_docker; then
+	skip "docker backend unavailable"
+	echo ""
+	echo "=== Results ==="
+	echo "Passed: $PASSED"
+	echo "Failed: $FAILED"
+	echo "Skipped: $SKIPPED"
+	exit 0
+fi
+
+TEST_ROOT=$(mktemp -d)
+TEST_HOME="$TEST_ROOT/home"
+TEST_WORKDIR="$TEST_ROOT/cco-pool-test-$$"
+mkdir -p "$TEST_HOME" "$TEST_WORKDIR"
+TEST_WORKDIR="$(cd "$TEST_WORKDIR" && pwd -P)"
+POOL_DIR_HASH="$(hash_string "$TEST_WORKDIR")"
+
+pool_containers() {
+	docker ps -a --filter "label=cco.pool.dir=$POOL_DIR_HASH" --format '{{.Names}}'
+}
+
+cleanup_test_artifacts() {
+	pool_containers | xargs docker rm -f >/dev/null 2>&1 || true
+	rm -rf "$TEST_ROOT"
+}
+
+run_in_test_workdir() {
+	(
+		cd "$TEST_WORKDIR"
+		HOME="$TEST_HOME" "$CCO_BIN" "$@"
+	)
+}
+
+wait_for_idle_count() {
+	local expected="$1"
+	local tries=0
+	while [[ $(pool_containers | grep -c -- '-idle-' || true) -lt $expected ]]; do
+		tries=$((tries + 1))
+		[[ $tries -lt 60 ]] || return 1
+		sleep 1
+	done
+}
+
+trap cleanup_test_artifacts EXIT
+
+echo "Test: cco pool start pre-starts idle containers"
+if run_in_test_workdir --backend docker pool start 1 >"$TEST_ROOT/pool-start.log" 2>&1; then
+	assert_contains "$TEST_ROOT/pool-start.log" "Container pool ready: 1 idle" \
+		"pool start reports the ready containers"
+else
+	echo "  output:"
+	sed 's/^/    /' "$TEST_ROOT/pool-start.log"
+	fail "pool start succeeds"
+fi
+
+echo ""
+echo "Test: sessions claim a warm container and leave no state behind"
+if run_in_test_workdir --backend docker --command bash -lc \
+	'echo pooled >/tmp/cco-pool-proof && cat /tmp/cco-pool-proof && id -u' \
+	>"$TEST_ROOT/pool-first.log" 2>&1; then
+	assert_contains "$TEST_ROOT/pool-first.log" "Using warm pool container" \
+		"session uses the warm pool"
+	assert_contains "$TEST_ROOT/pool-first.log" "$(id -u)" \
+		"pooled session runs as the host UID"
+else
+	echo "  output:"
+	sed 's/^/    /' "$TEST_ROOT/pool-first.log"
+	fail "pooled session succeeds"
+fi
+
+if wait_for_idle_count 1 && run_in_test_workdir --backend docker --command bash -lc \
+	'test ! -e /tmp/cco-pool-proof' >"$TEST_ROOT/pool-second.log" 2>&1; then
+	assert_contains "$TEST_ROOT/pool-second.log" "Using warm pool container" \
+		"pool is refilled after a session"
+	pass "pooled containers are not reused across sessions"
+else
+	echo "  output:"
+	sed 's/^/    /' "$TEST_ROOT/pool-second.log"
+	fail "pooled containers are not reused across sessions"
+fi
+
+echo ""
+echo "Test: --allow-oauth-refresh sessions stay off the pool"
+wait_for_idle_count 1 || true
+if (cd "$TEST_WORKDIR" && HOME="$TEST_HOME" "$CCO_BIN" --backend docker --allow-oauth-refresh --command true) \
+	>"$TEST_ROOT/pool-oauth.log" 2>&1 && ! grep -q "warm pool" "$TEST_ROOT/pool-oauth.log"; then
+	pass "--allow-oauth-refresh starts a fresh container"
+else
+	echo "  output:"
+	sed 's/^/    /' "$TEST_ROOT/pool-oauth.log"
+	fail "--allow-oauth-refresh starts a fresh container"
+fi
+if ! run_in_test_workdir --backend docker --allow-oauth-refresh pool start 1 >"$TEST_ROOT/pool-oauth-start.log" 2>&1; then
+	assert_contains "$TEST_ROOT/pool-oauth-start.log" "cco pool cannot be combined with --allow-oauth-refresh" \
+		"pool start rejects --allow-oauth-refresh"
+else
+	fail "pool start rejects --allow-oauth-refresh"
+fi
+
+echo ""
+echo "Test: CCO_POOL=0 bypasses the pool"
+if (cd "$TEST_WORKDIR" && HOME="$TEST_HOME" CCO_POOL=0 "$CCO_BIN" --backend docker --command true) \
+	>"$TEST_ROOT/pool-bypass.log" 2>&1 && ! grep -q "warm pool" "$TEST_ROOT/pool-bypass.log"; then
+	pass "CCO_POOL=0 starts a fresh container"
+else
+	echo "  output:"
+	sed 's/^/    /' "$TEST_ROOT/pool-bypass.log"
+	fail "CCO_POOL=0 starts a fresh container"
+fi
+
+echo ""
+echo "Test: cco pool stop removes the pool"
+wait_for_idle_count 1 || true
+if run_in_test_workdir --backend docker pool stop >"$TEST_ROOT/pool-stop.log" 2>&1 &&
+	[[ -z "$(pool_containers)" ]]; then
+	pass "pool stop removes pooled containers"
+else
+	echo "  output:"
+	sed 's/^/    /' "$TEST_ROOT/pool-stop.log"
+	fail "pool stop removes pooled containers"
+fi
+
+echo ""
+echo "=== Results ==="
+echo "Passed: $PASSED"
+echo "Failed: $FAILED"
+echo "Skipped: $SKIPPED"
+
+if [[ $FAILED -gt 0 ]]; then
+	exit 1
+fi
@@ -0,0 +1,189 @@
+#!/usr/bin/env bash
+# Tests for per-session resource limits (--cpus, --memory, --io-weight,
+# --cpuset). Docker, bwrap, systemd-run and taskset are stubbed.
+# shellcheck disable=SC1090
+
+set -euo pipefail
+
+cd "$(dirname "$0")/.."
+CCO_BIN="$PWD/cco"
+SANDBOX_BIN="$PWD/sandbox"
+
+PASSED=0
+FAILED=0
+SKIPPED=0
+
+pass() {
+	echo "PASS: $1"
+	PASSED=$((PASSED + 1))
+}
+
+fail() {
+	echo "FAIL: $1"
+	FAILED=$((FAILED + 1))
+}
+
+skip() {
+	echo "SKIP: $1"
+	SKIPPED=$((SKIPPED + 1))
+}
+
+assert_contains() {
+	local file="$1"
+	local expected="$2"
+	local name="$3"
+	if grep -Fxq -- "$expected" "$file"; then
+		pass "$name"
+	else
+		echo "  expected to find: $expected"
+		echo "  output:"
+		sed 's/^/    /' "$file"
+		fail "$name"
+	fi
+}
+
+echo "=== Resource Limit Tests ==="
+echo "Platform: $(uname -s) ($(uname -m))"
+echo ""
+
+TEST_ROOT=$(mktemp -d)
+trap 'rm -rf "$TEST_ROOT"' EXIT
+
+FUNCTIONS_ONLY="$TEST_ROOT/cco_functions.sh"
+sed '/^# Initialize variables$/q' "$CCO_BIN" >"$FUNCTIONS_ONLY"
+
+STUB_BIN="$TEST_ROOT/bin"
+PROJ_DIR="$TEST_ROOT/project"
+mkdir -p "$STUB_BIN" "$PROJ_DIR" "$TEST_ROOT/home/.claude"
+cat >"$STUB_BIN/docker" <<EOF
+#!/usr/bin/env bash
+if [[ "\$1" == "run" ]]; then
+	printf '%s\n' "\$@" >"$TEST_ROOT/docker_run_args"
+fi
+exit 0
+EOF
+chmod +x "$STUB_BIN/docker"
+
+echo "Test: Docker sessions get the limits as run options"
+if (cd "$PROJ_DIR" && HOME="$TEST_ROOT/home" XDG_CACHE_HOME="$TEST_ROOT/cache" PATH="$STUB_BIN:$PATH" \
+	"$CCO_BIN" --backend docker --cpus 1.5 --memory 4g --io-weight 200 --cpuset 0-1 --command true) \
+	>"$TEST_ROOT/launch.log" 2>&1; then
+	tr '\n' ' ' <"$TEST_ROOT/docker_run_args" >"$TEST_ROOT/docker_run_line"
+	echo >>"$TEST_ROOT/docker_run_line"
+	if grep -q -- "--cpus 1.5 --memory 4g --blkio-weight 200 --cpuset-cpus 0-1 " "$TEST_ROOT/docker_run_line"; then
+		pass "Docker sessions get the limits as run options"
+	else
+		sed 's/^/    /' "$TEST_ROOT/docker_run_line"
+		fail "Docker sessions get the limits as run options"
+	fi
+else
+	sed 's/^/    /' "$TEST_ROOT/launch.log"
+	fail "Docker sessions get the limits as run options"
+fi
+
+echo "Test: invalid limits are rejected"
+if (cd "$PROJ_DIR" && HOME="$TEST_ROOT/home" PATH="$STUB_BIN:$PATH" \
+	"$CCO_BIN" --backend docker --io-weight 5 --command true) >"$TEST_ROOT/bad.log" 2>&1; then
+	fail "invalid limits are rejected"
+elif grep -q "io-weight requires a weight from 10 to 1000" "$TEST_ROOT/bad.log"; then
+	pass "invalid limits are rejected"
+else
+	sed 's/^/    /' "$TEST_ROOT/bad.log"
+	fail "invalid limits are rejected"
+fi
+
+echo ""
+echo "Test: --cpuset auto spreads sessions across NUMA nodes"
+if output=$(
+	XDG_CACHE_HOME="$TEST_ROOT/cpusets" FUNCTIONS_ONLY="$FUNCTIONS_ONLY" bash <<'EOF' 2>&1
+set -euo pipefail
+source "$FUNCTIONS_ONLY"
+numa_node_cpus() { printf "0 0-3\n1 4-7\n"; }
+resource_cpus=2
+for i in 1 2 3 4 5; do
+	resource_cpuset=auto
+	resource_cpuset_mems=""
+	assign_auto_cpuset >/dev/null 2>&1
+	echo "session $i: $resource_cpuset node $resource_cpuset_mems"
+done
+# Leases of exited processes free their slot
+rm -f "$(cpuset_state_root)"/1.0/*
+: >"$(cpuset_state_root)/1.0/999999999.1"
+resource_cpuset=auto
+assign_auto_cpuset >/dev/null 2>&1
+echo "after exit: $resource_cpuset node $resource_cpuset_mems"
+EOF
+); then
+	expected="session 1: 0,1 node 0
+session 2: 4,5 node 1
+session 3: 2,3 node 0
+session 4: 6,7 node 1
+session 5: 0,1 node 0
+after exit: 4,5 node 1"
+	if [[ "$(printf '%s\n' "$output" | grep -E '^(session|after)')" == "$expected" ]]; then
+		pass "--cpuset auto spreads sessions across NUMA nodes"
+	else
+		printf '%s\n' "$output" | sed 's/^/    /'
+		fail "--cpuset auto spreads sessions across NUMA nodes"
+	fi
+else
+	printf '%s\n' "$output" | sed 's/^/    /'
+	fail "--cpuset auto spreads sessions across NUMA nodes"
+fi
+
+echo ""
+echo "Test: the native sandbox runs in a transient systemd scope"
+if [[ "$(uname -s)" == "Linux" ]]; then
+	printf '#!/bin/sh\nprintf "%%s\\n" "$@"\n' >"$STUB_BIN/bwrap"
+	cat >"$STUB_BIN/systemd-run" <<EOF
+#!/usr/bin/env bash
+echo "systemd-run \$*" >>"$TEST_ROOT/scope.log"
+while [[ \$# -gt 0 && "\$1" != "--" ]]; do
+	[[ "\$1" != "true" ]] || exit 0
+	shift
+done
+shift
+exec "\$@"
+EOF
+	cat >"$STUB_BIN/taskset" <<EOF
+#!/usr/bin/env bash
+echo "taskset \$1 \$2" >>"$TEST_ROOT/scope.log"
+shift 2
+exec "\$@"
+EOF
+	chmod +x "$STUB_BIN/bwrap" "$STUB_BIN/systemd-run" "$STUB_BIN/taskset"
+	if (cd "$PROJ_DIR" && PATH="$STUB_BIN:$PATH" XDG_CACHE_HOME="$TEST_ROOT/cache" \
+		"$SANDBOX_BIN" --cpus 1.5 --memory 2g --io-weight 300 --cpuset 2-3 --cpuset-mems 0 -- true) \
+		>"$TEST_ROOT/sandbox.log" 2>&1; then
+		grep '^systemd-run .* -- ' "$TEST_ROOT/scope.log" | sed 's/ -- taskset -c 2-3 .*/ -- taskset -c 2-3/' >"$TEST_ROOT/scope_last"
+		assert_contains "$TEST_ROOT/scope_last" "systemd-run --scope --quiet --collect$([[ "$(id -u)" -eq 0 ]] || echo " --user") -p CPUQuota=150% -p MemoryMax=2G -p IOWeight=300 -p AllowedCPUs=2-3 -p AllowedMemoryNodes=0 -- taskset -c 2-3" \
+			"limits become scope properties"
+		assert_contains "$TEST_ROOT/scope.log" "taskset -c 2-3" "CPU pinning also sets the affinity"
+		assert_contains "$TEST_ROOT/sandbox.log" "true" "the command still runs under bwrap"
+		: >"$TEST_ROOT/scope.log"
+		if (cd "$PROJ_DIR" && PATH="$STUB_BIN:$PATH" XDG_CACHE_HOME="$TEST_ROOT/cache" \
+			"$SANDBOX_BIN" --memory 2g -- true) >"$TEST_ROOT/sandbox.log" 2>&1 &&
+			grep -q -- ' -p MemoryMax=2G -- ' "$TEST_ROOT/scope.log" &&
+			! grep -qx 'systemd-run --scope --quiet --collect\( --user\)\? true' "$TEST_ROOT/scope.log"; then
+			pass "later launches skip the scope probe"
+		else
+			sed 's/^/    /' "$TEST_ROOT/scope.log"
+			fail "later launches skip the scope probe"
+		fi
+	else
+		sed 's/^/    /' "$TEST_ROOT/sandbox.log"
+		fail "the native sandbox runs in a transient systemd scope"
+	fi
+else
+	skip "the native sandbox runs in a transient systemd scope (Linux only)"
+fi
+
+echo ""
+echo "=== Results ==="
+echo "Passed: $PASSED"
+echo "Failed: $FAILED"
+echo "Skipped: $SKIPPED"
+
+if [[ $FAILED -gt 0 ]]; then
+	exit 1
+fi
@@ -469,6 +469,171 @@ if [[ "$OS" == "Darwin" ]]; then
 	fi
 fi
 
+#
+# Policy cache (Linux; a stub bwrap prints the arguments it was given)
+#
+
+echo ""
+echo "--- Policy Cache ---"
+
+if [[ "$OS" == "Linux" ]]; then
+	cache_bin="$TEST_DIR/cache-bin"
+	mkdir -p "$cache_bin" "$TEST_DIR/cache-work/secret"
+	printf '#!/bin/sh\nprintf "%%s\\n" "$@"\n' >"$cache_bin/bwrap"
+	chmod +x "$cache_bin/bwrap"
+	run_cached() {
+		(cd "$TEST_DIR/cache-work" && PATH="$cache_bin:$PATH" XDG_CACHE_HOME="$TEST_DIR/cache-home" \
+			CCO_DEBUG=1 "$OLDPWD/sandbox" "$@" -- true)
+	}
+
+	echo "Test: Warm launch reuses the cached policy"
+	cold=$(run_cached --deny secret 2>/dev/null)
+	warm=$(run_cached --deny secret 2>&1)
+	if [[ "$warm" == *"Using cached policy"* && "$(echo "$warm" | grep -v '^DEBUG')" == "$cold" ]]; then
+		pass "Warm launch reuses the cached policy"
+	else
+		fail "Warm launch reuses the cached policy"
+	fi
+
+	echo "Test: Changed inputs miss the policy cache"
+	other=$(run_cached --deny secret --read-only secret 2>&1)
+	if [[ "$other" != *"Using cached policy"* && "$other" == *"Deny path with exceptions"* ]]; then
+		pass "Changed inputs miss the policy cache"
+	else
+		fail "Changed inputs miss the policy cache"
+	fi
+
+	echo "Test: CCO_POLICY_CACHE=0 disables the policy cache"
+	entries_before=$(find "$TEST_DIR/cache-home/cco/policy" -type f -name policy | wc -l)
+	CCO_POLICY_CACHE=0 run_cached --deny "$TEST_DIR" >/dev/null 2>&1
+	entries_after=$(find "$TEST_DIR/cache-home/cco/policy" -type f -name policy | wc -l)
+	if [[ "$entries_before" -eq 2 && "$entries_after" -eq 2 ]]; then
+		pass "CCO_POLICY_CACHE=0 disables the policy cache"
+	else
+		fail "CCO_POLICY_CACHE=0 disables the policy cache: $entries_before -> $entries_after entries"
+	fi
+	chmod -R u+rwx "$TEST_DIR/cache-home"
+
+	echo "Test: Deny overlays are shared from the overlay store"
+	mkdir -p "$TEST_DIR/cache-work/secret/keep" "$TEST_DIR/cache-work/tmp"
+	store_run() {
+		(cd "$TEST_DIR/cache-work" && PATH="$1:$PATH" XDG_CACHE_HOME="$2" TMPDIR="$TEST_DIR/cache-work/tmp" \
+			CCO_POLICY_CACHE=0 "$OLDPWD/sandbox" --deny secret --read-only secret/keep --deny "$TEST_DIR/plan-none" -- true 2>/dev/null |
+			sed "s#^$2/cco/overlays/##")
+	}
+	mkdir -p "$TEST_DIR/plan-none"
+	first=$(store_run "$cache_bin" "$TEST_DIR/store-c")
+	second=$(store_run "$cache_bin" "$TEST_DIR/store-c")
+	if [[ "$first" == "$second" && "$first" == *deny-tree-* && "$first" == *deny-dir-000* &&
+		-z "$(ls -A "$TEST_DIR/cache-work/tmp")" ]]; then
+		pass "Deny overlays are shared from the overlay store"
+	else
+		fail "Deny overlays are shared from the overlay store"
+	fi
+
+	echo "Test: Bash fallback uses the same overlay store keys as mount_plan"
+	nocc_bin="$TEST_DIR/nocc-bin"
+	mkdir -p "$nocc_bin"
+	cp "$cache_bin/bwrap" "$nocc_bin/bwrap"
+	printf '#!/bin/sh\nexit 1\n' >"$nocc_bin/cc"
+	chmod +x "$nocc_bin/cc"
+	fallback=$(store_run "$nocc_bin" "$TEST_DIR/store-bash")
+	if [[ -n "$fallback" && "$fallback" == "$first" && ! -e "$TEST_DIR/store-bash/cco/mount_plan" ]]; then
+		pass "Bash fallback uses the same overlay store keys as mount_plan"
+	else
+		fail "Bash fallback uses the same overlay store keys as mount_plan"
+	fi
+	chmod -R u+rwx "$TEST_DIR/store-c" "$TEST_DIR/store-bash"
+
+	echo "Test: --overlay mounts the current directory copy-on-write"
+	mkdir -p "$TEST_DIR/fork-upper" "$TEST_DIR/fork-work"
+	work_real="$(cd "$TEST_DIR/cache-work" && pwd -P)"
+	overlay_args=$(run_cached --overlay "$TEST_DIR/fork-upper" "$TEST_DIR/fork-work" 2>/dev/null | tr '\n' ' ')
+	overlay_again=$(run_cached --overlay "$TEST_DIR/fork-upper" "$TEST_DIR/fork-work" 2>&1)
+	if [[ "$overlay_args" == *"--overlay-src $work_real --overlay "*"/fork-upper "*"/fork-work $work_real "* &&
+		"$overlay_args" != *"--bind $work_real $work_real "* && "$overlay_again" != *"Using cached policy"* ]]; then
+		pass "--overlay mounts the current directory copy-on-write"
+	else
+		fail "--overlay mounts the current directory copy-on-write: $overlay_args"
+	fi
+
+	echo "Test: Launch plans replay the cached bwrap command without the script"
+	plan="$TEST_DIR/cache-home/cco/launch/test-plan"
+	helper="$TEST_DIR/cache-home/cco/tiocsti_filter_helper"
+	run_cached --launch-plan "$plan" --deny secret >/dev/null 2>&1
+	scripted=$(run_cached --launch-plan "$plan" --deny secret 2>/dev/null)
+	launch_via_plan() {
+		(cd "$TEST_DIR/cache-work" && PATH="$cache_bin:$PATH" XDG_CACHE_HOME="$TEST_DIR/cache-home" \
+			CCO_DEBUG=1 "$helper" --launch "$plan" "$OLDPWD/sandbox" --launch-plan "$plan" "$@" -- true)
+	}
+	if [[ -f "$plan" && -x "$helper" ]]; then
+		replayed=$(launch_via_plan --deny secret 2>&1)
+		policy_file=$(tr '\0' '\n' <"$plan" | sed -n 's#^m\(.*/policy\)$#\1#p')
+		other_flags=$(launch_via_plan --deny secret --read-only secret 2>&1)
+		touch "$policy_file"
+		stale=$(launch_via_plan --deny secret 2>&1)
+		if [[ -n "$scripted" && "$replayed" == "$scripted" && "$other_flags" != "$scripted" &&
+			"$stale" == *"Using cached policy"* ]]; then
+			pass "Launch plans replay the cached bwrap command without the script"
+		else
+			fail "Launch plans replay the cached bwrap command without the script: $replayed"
+		fi
+	else
+		fail "Launch plans replay the cached bwrap command without the script (no plan saved)"
+	fi
+	chmod -R u+rwx "$TEST_DIR/cache-home"
+else
+	skip "Policy cache tests (Linux only)"
+fi
+
+#
+# Mount plan helper (Linux)
+#
+
+echo ""
+echo "--- Mount Plan Helper ---"
+
+if [[ "$OS" == "Linux" ]] && command -v cc >/dev/null 2>&1; then
+	echo "Test: mount_plan matches the bash deny/allow ordering"
+	plan_dir="$TEST_DIR/plan"
+	mkdir -p "$plan_dir/tmp" "$plan_dir/deny/sub/inner" "$plan_dir/ro"
+	echo "secret" >"$plan_dir/deny/file"
+	echo "secret" >"$plan_dir/secret"
+	if cc -O2 -o "$TEST_DIR/mount_plan" seccomp/mount_plan.c 2>/dev/null; then
+		plan_real="$(cd "$plan_dir" && pwd -P)"
+		plan_output=$(cd "$plan_dir" && TMPDIR="$plan_real/tmp" "$TEST_DIR/mount_plan" \
+			-w deny/sub/inner -r deny/file -w deny/newfile -r ro -d deny -d secret |
+			tr '\0' '\n' | sed "s#^\([AC]\)$plan_real/tmp/tmp\.[A-Za-z0-9]*#\1TMP#; s#$plan_real#P#")
+		expected=$(printf '%s\n' "A--ro-bind" "AP/ro" "AP/ro" \
+			"CTMP" "A--ro-bind" "ATMP" "AP/deny" \
+			"A--bind" "AP/deny/sub/inner" "AP/deny/sub/inner" \
+			"A--bind" "AP/deny/newfile" "AP/deny/newfile" \
+			"A--ro-bind" "AP/deny/file" "AP/deny/file" \
+			"CTMP" "A--ro-bind" "ATMP" "AP/secret" "E")
+		overlay=$(find "$plan_real/tmp" -mindepth 1 -maxdepth 1 -type d)
+		if [[ "$plan_output" == "$expected" && -f "$plan_dir/deny/newfile" &&
+			"$(stat -c '%a' "$overlay")" == "111" && -d "$overlay/sub/inner" ]]; then
+			pass "mount_plan matches the bash deny/allow ordering"
+		else
+			fail "mount_plan matches the bash deny/allow ordering: got $(echo "$plan_output" | tr '\n' ' ')"
+		fi
+		chmod -R u+rwx "$plan_real/tmp"
+	else
+		fail "mount_plan compiles"
+	fi
+
+	echo "Test: mount_plan rejects a missing parent directory"
+	plan_exit=0
+	plan_err=$("$TEST_DIR/mount_plan" -w "$TEST_DIR/missing/file" 2>&1 >/dev/null) || plan_exit=$?
+	if [[ $plan_exit -eq 2 && "$plan_err" == *"parent directory does not exist"* ]]; then
+		pass "mount_plan rejects a missing parent directory"
+	else
+		fail "mount_plan rejects a missing parent directory: exit $plan_exit, '$plan_err'"
+	fi
+else
+	skip "Mount plan helper tests (Linux with a C compiler only)"
+fi
+
 #
 # Platform-specific tests
 #
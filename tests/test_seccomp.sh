@@ -69,6 +69,59 @@ int main() {
 }
 EOF
 	gcc -o /tmp/test_tioclinux /tmp/test_tioclinux.c
+
+	cat >/tmp/test_keyctl.c <<'EOF'
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+int main() {
+    /* KEYCTL_GET_KEYRING_ID (0) on the session keyring (-3) */
+    if (syscall(SYS_keyctl, 0, -3, 0) < 0) {
+        if (errno == EPERM) {
+            printf("blocked\n");
+            return 0;
+        }
+        printf("error: %s\n", strerror(errno));
+        return 2;
+    }
+    printf("allowed\n");
+    return 1;
+}
+EOF
+	gcc -o /tmp/test_keyctl /tmp/test_keyctl.c
+
+	# Installs a raw filter file with prctl() and execs the command, so
+	# generated filters can be exercised without bubblewrap.
+	cat >/tmp/test_seccomp_load.c <<'EOF'
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+int main(int argc, char **argv) {
+    static struct sock_filter insns[4096];
+    struct sock_fprog prog;
+    FILE *fp;
+    if (argc < 3 || !(fp = fopen(argv[1], "rb"))) {
+        return 126;
+    }
+    prog.len = (unsigned short)fread(insns, sizeof(insns[0]), 4096, fp);
+    prog.filter = insns;
+    fclose(fp);
+    if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) || prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog)) {
+        perror("seccomp");
+        return 126;
+    }
+    execv(argv[2], argv + 2);
+    perror("execv");
+    return 127;
+}
+EOF
+	gcc -o /tmp/test_seccomp_load /tmp/test_seccomp_load.c
+
+	cc -O2 -Wall -Werror -o /tmp/tiocsti_filter_gen seccomp/tiocsti_filter.c
 }
 
 echo "=== Seccomp Filter Tests (Linux-only) ==="
@@ -124,6 +177,193 @@ else
 	fail "Normal ioctl broken by seccomp filter"
 fi
 
+# Test 6: Built-in policy matches the shipped filter's behaviour
+echo "Test 6: Generated default filter blocks TIOCSTI"
+result=""
+if /tmp/tiocsti_filter_gen --fuzz 200000 /tmp/test_default.bpf >/dev/null &&
+	result=$(/tmp/test_seccomp_load /tmp/test_default.bpf /tmp/test_tiocsti 2>&1) &&
+	[[ "$result" == "blocked" ]]; then
+	pass "Generated default filter blocks TIOCSTI"
+else
+	fail "Generated default filter: ${result:-generation failed}"
+fi
+
+# Test 7: Policy files compile for every supported architecture
+echo "Test 7: hardened.policy compiles for all architectures"
+compiled_all=true
+for target in x86_64 aarch64 i386 arm riscv64 ppc64le s390x; do
+	if ! /tmp/tiocsti_filter_gen --arch "$target" --policy seccomp/hardened.policy "/tmp/test_hardened_$target.bpf" >/dev/null; then
+		compiled_all=false
+		echo "  failed for $target"
+	fi
+done
+if [[ "$compiled_all" == true ]]; then
+	pass "hardened.policy compiles for all architectures"
+else
+	fail "hardened.policy compilation"
+fi
+
+# Test 8: Unconditional syscall rules and argument rules are both enforced
+echo "Test 8: hardened.policy blocks keyctl and TIOCSTI, allows the rest"
+hardened="/tmp/test_hardened_$arch.bpf"
+keyctl_result=$(/tmp/test_seccomp_load "$hardened" /tmp/test_keyctl 2>&1 || true)
+tiocsti_result=$(/tmp/test_seccomp_load "$hardened" /tmp/test_tiocsti 2>&1 || true)
+if [[ "$keyctl_result" == "blocked" && "$tiocsti_result" == "blocked" ]] &&
+	/tmp/test_seccomp_load "$hardened" /bin/ls /dev/null >/dev/null 2>&1; then
+	pass "hardened.policy enforced"
+else
+	fail "hardened.policy enforcement: keyctl=$keyctl_result tiocsti=$tiocsti_result"
+fi
+
+# Test 9: Invalid policies are rejected with a line number
+echo "Test 9: Invalid policy rejected"
+printf 'errno ioctl arg1 TIOCSTI\nerrno no_such_syscall\n' >/tmp/test_bad.policy
+if output=$(/tmp/tiocsti_filter_gen --policy /tmp/test_bad.policy /tmp/test_bad.bpf 2>&1); then
+	fail "Invalid policy accepted"
+elif [[ "$output" == *"test_bad.policy:2: unknown syscall 'no_such_syscall'"* ]]; then
+	pass "Invalid policy rejected with location"
+else
+	fail "Invalid policy error message: $output"
+fi
+
+# Test 10: Hot syscalls take the fast path ahead of the rule tree
+echo "Test 10: Hot set shortens the read() path"
+hot_cost() {
+	/tmp/tiocsti_filter_gen "$@" | awk '$1 == "hot" && $2 == "read" { print $3 }'
+}
+cold_cost() {
+	/tmp/tiocsti_filter_gen "$@" | awk '$1 == "other" { split($4, r, "-"); print r[2] }'
+}
+hot=$(hot_cost --policy seccomp/hardened.policy /tmp/test_hot.bpf)
+cold=$(cold_cost --policy seccomp/hardened.policy --hot none /tmp/test_cold.bpf)
+keyctl_result=$(/tmp/test_seccomp_load /tmp/test_hot.bpf /tmp/test_keyctl 2>&1 || true)
+if [[ -n "$hot" && -n "$cold" && "$hot" -lt "$cold" && "$keyctl_result" == "blocked" ]]; then
+	pass "read() runs $hot instructions with the hot set (up to $cold without)"
+else
+	fail "Hot set: hot=$hot cold=$cold keyctl=$keyctl_result"
+fi
+for policy in "" seccomp/hardened.policy; do
+	costs=$(/tmp/tiocsti_filter_gen --arch x86_64 ${policy:+--policy "$policy"} /tmp/test_hot_tail.bpf |
+		awk '$1 == "hot" && $3 > max { max = $3 } $1 == "other" { mean = $6 } END { print max, mean }')
+	name=${policy:-default}; name=${name##*/}
+	if awk -v hot="${costs% *}" -v tail="${costs#* }" 'BEGIN { exit !(tail != "" && hot + 0 < tail + 0) }'; then
+		pass "Every hot syscall beats the tail mean under $name (x86_64: $costs)"
+	else
+		fail "Hot set not below the tail under $name: hot max / tail mean = $costs"
+	fi
+done
+
+# Test 11: Action-cache analysis keeps the hot set on the cached path
+echo "Test 11: --analyze reports cacheable syscalls"
+printf 'hot read ioctl\nerrno ioctl arg1 TIOCSTI\n' >/tmp/test_hot_ioctl.policy
+analysis=$(/tmp/tiocsti_filter_gen --analyze --policy seccomp/hardened.policy 2>&1) && analyze_rc=0 || analyze_rc=$?
+/tmp/tiocsti_filter_gen --analyze --policy /tmp/test_hot_ioctl.policy >/dev/null 2>&1 && bad_rc=0 || bad_rc=$?
+if [[ $analyze_rc -eq 0 && "$analysis" == *"Hot set:         all cached"* &&
+	"$analysis" =~ ioctl\ +16$'\n' && $bad_rc -eq 2 ]]; then
+	pass "Action-cache analysis (hot ioctl rule rejected with exit 2)"
+else
+	fail "Action-cache analysis: rc=$analyze_rc bad_rc=$bad_rc"
+fi
+
+# Test 12: The checked-in bundle is current and sandbox can extract from it
+echo "Test 12: Multi-arch filter bundle"
+eval "$(sed -n '/^bundle_extract_filter() {/,/^}/p' sandbox)"
+/tmp/tiocsti_filter_gen --bundle /tmp/test_filter.bundle >/dev/null
+cp /tmp/test_filter.bundle /tmp/test_corrupt.bundle
+printf '\377' | dd of=/tmp/test_corrupt.bundle bs=1 seek=520 conv=notrunc 2>/dev/null
+rm -f /tmp/test_bundle.bpf /tmp/test_corrupt.bpf
+result=""
+if cmp -s /tmp/test_filter.bundle seccomp/tiocsti_filter.bundle &&
+	bundle_extract_filter seccomp/tiocsti_filter.bundle "$arch" /tmp/test_bundle.bpf &&
+	result=$(/tmp/test_seccomp_load /tmp/test_bundle.bpf /tmp/test_tiocsti 2>&1) &&
+	[[ "$result" == "blocked" ]] &&
+	! bundle_extract_filter /tmp/test_corrupt.bundle x86_64 /tmp/test_corrupt.bpf &&
+	[[ ! -e /tmp/test_corrupt.bpf ]]; then
+	pass "Bundle is up to date, extracts for $arch, rejects corruption"
+else
+	fail "Bundle: ${result:-stale (run make seccomp) or extraction failed}"
+fi
+
+# Test 13: Offline verifier cross-checks the legacy generate_bpf.py filters
+echo "Test 13: Offline verifier and fuzz corpus"
+verified_all=true
+for target in x86_64 aarch64; do
+	if ! /tmp/tiocsti_filter_gen --verify "seccomp/tiocsti_filter_$target.bpf" --arch "$target" >/dev/null; then
+		verified_all=false
+		echo "  legacy $target filter failed verification"
+	fi
+done
+if command -v python3 >/dev/null 2>&1; then
+	mkdir -p /tmp/test_generate_bpf
+	cp seccomp/generate_bpf.py /tmp/test_generate_bpf/
+	python3 /tmp/test_generate_bpf/generate_bpf.py >/dev/null
+	for target in x86_64 aarch64; do
+		if ! cmp -s "/tmp/test_generate_bpf/tiocsti_filter_$target.bpf" "seccomp/tiocsti_filter_$target.bpf"; then
+			verified_all=false
+			echo "  generate_bpf.py output differs from checked-in $target filter"
+		fi
+	done
+fi
+# A wrong policy and a broken jump offset must both be caught
+cp seccomp/tiocsti_filter_x86_64.bpf /tmp/test_broken.bpf
+printf '\011' | dd of=/tmp/test_broken.bpf bs=1 seek=74 conv=notrunc 2>/dev/null
+if [[ "$verified_all" == true ]] &&
+	/tmp/tiocsti_filter_gen --policy seccomp/hardened.policy --fuzz 200000 /tmp/test_fuzz.bpf >/dev/null 2>&1 &&
+	! /tmp/tiocsti_filter_gen --verify seccomp/tiocsti_filter_x86_64.bpf --arch x86_64 \
+		--policy seccomp/hardened.policy --fuzz 10000 >/dev/null 2>&1 &&
+	! /tmp/tiocsti_filter_gen --verify /tmp/test_broken.bpf --arch x86_64 >/dev/null 2>&1; then
+	pass "Legacy filters verified; policy mismatch and bad jump detected"
+else
+	fail "Offline verifier"
+fi
+
+# Test 14: USER_NOTIF supervisor logs audited syscalls and lets them run
+echo "Test 14: --supervise logs connect/execve"
+rm -f /tmp/test_audit.log
+status=0
+supervise_err=$(/tmp/tiocsti_filter_gen --supervise /tmp/test_audit.log --policy seccomp/audit.policy -- \
+	/bin/bash -c '/bin/true; (exec 3<>/dev/tcp/127.0.0.1/9) 2>/dev/null; exit 3' 2>&1) || status=$?
+if [[ "$supervise_err" == *"user notification unavailable"* ]]; then
+	echo "  SKIP: kernel lacks seccomp user notification"
+elif [[ $status -eq 3 ]] && grep -q 'execve "/bin/true"' /tmp/test_audit.log &&
+	grep -q 'connect "127.0.0.1:9"' /tmp/test_audit.log; then
+	pass "Supervisor logged execve and connect, command exit status preserved"
+else
+	fail "Supervisor: status=$status $supervise_err $(cat /tmp/test_audit.log 2>/dev/null)"
+fi
+
+# Test 15: Processes left behind by the command are still audited (skipped
+# along with Test 14 when the kernel has no user notification)
+echo "Test 15: --supervise serves until no task is left under the filter"
+rm -f /tmp/test_audit.log
+status=0
+/tmp/tiocsti_filter_gen --supervise /tmp/test_audit.log --policy seccomp/audit.policy -- \
+	/bin/bash -c '(sleep 0.3; exec /bin/true) </dev/null >/dev/null 2>&1 & exit 4' >/dev/null 2>&1 || status=$?
+if [[ "$supervise_err" == *"user notification unavailable"* ]]; then
+	echo "  SKIP: kernel lacks seccomp user notification"
+elif [[ $status -eq 4 ]] && grep -q 'execve "/bin/true"' /tmp/test_audit.log; then
+	pass "Background process audited after the command exited"
+else
+	fail "Supervisor lifetime: status=$status $(cat /tmp/test_audit.log 2>/dev/null)"
+fi
+
+# Test 16: A setuid command is refused rather than run under no_new_privs
+echo "Test 16: --supervise refuses a setuid command"
+if [[ "$(id -u)" -ne 0 ]]; then
+	echo "  SKIP: needs root to create a setuid binary owned by another user"
+else
+	cp /bin/true /tmp/test_setuid_true
+	chown 65534 /tmp/test_setuid_true && chmod u+s /tmp/test_setuid_true
+	status=0
+	supervise_err=$(/tmp/tiocsti_filter_gen --supervise /tmp/test_audit.log -- /tmp/test_setuid_true 2>&1) || status=$?
+	if [[ $status -eq 1 && "$supervise_err" == *"cannot run /tmp/test_setuid_true: it is setuid"* ]]; then
+		pass "Setuid command refused with an error"
+	else
+		fail "Setuid command: status=$status $supervise_err"
+	fi
+	rm -f /tmp/test_setuid_true
+fi
+
 echo ""
 echo "=== Results ==="
 echo "Passed: $PASSED"
@@ -265,6 +265,458 @@ else
 	assert_contains "$output" "Run \`security unlock-keychain /tmp/test-login.keychain-db\` and then retry cco." "SSH keychain status fallback prints unlock command"
 fi
 
+echo ""
+echo "Test: CCO_TRACE=1 records wrapped phases as a Chrome trace"
+trace_out="$TEST_ROOT/trace.json"
+if output=$(
+	CCO_TRACE=1 CCO_TRACE_FILE="$trace_out" FUNCTIONS_ONLY="$FUNCTIONS_ONLY" bash <<'EOF' 2>&1
+set -euo pipefail
+source "$FUNCTIONS_ONLY"
+slow_phase() { sleep 0.05; return 3; }
+trace_wrap slow_phase
+slow_phase || [[ $? -eq 3 ]]
+trace_launch
+EOF
+); then
+	assert_contains "$output" "Startup trace" "trace summary is printed at launch"
+	assert_contains "$output" "slow_phase" "trace summary lists wrapped phases"
+	if python3 - "$trace_out" <<'EOF'
+import json, sys
+text = open(sys.argv[1]).read().rstrip().rstrip(",") + "]"
+events = json.loads(text)
+phases = {(e["name"], e["ph"]): e["ts"] for e in events}
+assert phases[("slow_phase", "E")] - phases[("slow_phase", "B")] >= 50000
+assert ("launch", "i") in phases
+EOF
+	then
+		pass "trace file is valid Chrome trace JSON with µs timestamps"
+	else
+		fail "trace file is valid Chrome trace JSON with µs timestamps"
+	fi
+else
+	printf '%s\n' "$output" | sed 's/^/    /'
+	fail "CCO_TRACE=1 wrapped phase preserves exit status"
+fi
+
+echo ""
+echo "Test: docker image preflight runs alongside the auth preflights"
+order_log="$TEST_ROOT/preflight_order.log"
+if output=$(
+	order_log="$order_log" FUNCTIONS_ONLY="$FUNCTIONS_ONLY" bash <<'EOF' 2>&1
+set -euo pipefail
+source "$FUNCTIONS_ONLY"
+prepare_docker_image() {
+	echo "image start" >>"$order_log"
+	sleep 0.3
+	IMAGE_NAME="cco:resolved"
+	image_build_needed=true
+	log "image checked"
+	echo "image done" >>"$order_log"
+	preflight_export IMAGE_NAME image_build_needed
+}
+IMAGE_NAME="cco:latest"
+preflight_start docker_image prepare_docker_image
+sleep 0.1
+echo "auth start" >>"$order_log"
+echo "auth done" >>"$order_log"
+preflight_join docker_image
+preflight_cleanup
+echo "joined $IMAGE_NAME $image_build_needed" >>"$order_log"
+EOF
+); then
+	assert_contains "$(tr '\n' ' ' <"$order_log")" "image start auth start auth done image done joined cco:resolved true" \
+		"image checks overlap auth and results reach the main shell"
+	assert_contains "$output" "image checked" "preflight output is replayed at the join"
+else
+	printf '%s\n' "$output" | sed 's/^/    /'
+	fail "docker image preflight joins cleanly"
+fi
+
+echo ""
+echo "Test: a failed preflight is reported at the join"
+if output=$(
+	FUNCTIONS_ONLY="$FUNCTIONS_ONLY" bash <<'EOF' 2>&1
+set -euo pipefail
+source "$FUNCTIONS_ONLY"
+failing_stage() {
+	error "Docker daemon is not running"
+	exit 1
+}
+preflight_start docker_image failing_stage
+preflight_join docker_image || exit $?
+echo "launched"
+EOF
+); then
+	printf '%s\n' "$output" | sed 's/^/    /'
+	fail "failed preflight stops startup"
+else
+	assert_contains "$output" "Docker daemon is not running" "failed preflight output is shown"
+	assert_contains "$output" "Startup check failed: docker_image" "failed preflight is named in the report"
+	if [[ "$output" != *"launched"* ]]; then
+		pass "failed preflight stops startup"
+	else
+		fail "failed preflight stops startup"
+	fi
+fi
+
+echo ""
+echo "Test: registry availability is cached per commit"
+if output=$(
+	REG_ROOT="$TEST_ROOT/registry" FUNCTIONS_ONLY="$FUNCTIONS_ONLY" bash <<'EOF' 2>&1
+source "$FUNCTIONS_ONLY"
+mkdir -p "$REG_ROOT/bin" "$REG_ROOT/install/.git/refs/heads" "$REG_ROOT/cache"
+CCO_INSTALLATION_DIR="$REG_ROOT/install"
+XDG_CACHE_HOME="$REG_ROOT/cache"
+IMAGE_NAME="cco:latest"
+echo "ref: refs/heads/master" >"$CCO_INSTALLATION_DIR/.git/HEAD"
+echo "0123456789abcdef0123456789abcdef01234567" >"$CCO_INSTALLATION_DIR/.git/refs/heads/master"
+cat >"$REG_ROOT/bin/git" <<STUB
+#!/usr/bin/env bash
+echo git >>"$REG_ROOT/calls"
+echo 0123456
+STUB
+cat >"$REG_ROOT/bin/docker" <<STUB
+#!/usr/bin/env bash
+echo "docker \$1 \$2" >>"$REG_ROOT/calls"
+case "\$1 \$2" in
+"manifest inspect") [[ -f "$REG_ROOT/published" ]] ;;
+"image inspect") echo "ghcr.io/nikvdp/cco@sha256:abc" ;;
+esac
+STUB
+chmod +x "$REG_ROOT/bin/git" "$REG_ROOT/bin/docker"
+PATH="$REG_ROOT/bin:$PATH"
+
+! pull_prebuilt_image
+! pull_prebuilt_image
+echo "missing: $(grep -c "manifest" "$REG_ROOT/calls") $(grep -c "^git" "$REG_ROOT/calls")"
+
+touch "$REG_ROOT/published"
+rm -f "$XDG_CACHE_HOME/cco/registry"
+pull_prebuilt_image
+: >"$REG_ROOT/calls"
+pull_prebuilt_image
+pull_prebuilt_image
+echo "present: $(grep -c "manifest" "$REG_ROOT/calls")"
+
+: >"$REG_ROOT/calls"
+pull_prebuilt_image
+echo "pulls: $(grep -c "docker pull" "$REG_ROOT/calls")"
+echo "tag: $(get_prebuilt_image_tag)"
+image_variant=slim
+echo "slim tag: $(get_prebuilt_image_tag)"
+EOF
+); then
+	assert_contains "$output" "missing: 1 1" "a missing image is remembered and git is only consulted once"
+	assert_contains "$output" "present: 0" "a pulled image skips the manifest check"
+	assert_contains "$output" "pulls: 0" "a previously pulled image is retagged without pulling"
+	assert_contains "$output" "tag: ghcr.io/nikvdp/cco:0123456"$'\n' "commit tag is served from the cache"
+	assert_contains "$output" "slim tag: ghcr.io/nikvdp/cco:0123456-slim" "slim variant uses its own prebuilt tag"
+else
+	printf '%s\n' "$output" | sed 's/^/    /'
+	fail "registry availability is cached per commit"
+fi
+
+echo ""
+echo "Test: lazy-pulling snapshotters skip the manifest check"
+if output=$(
+	LAZY_ROOT="$TEST_ROOT/lazy" FUNCTIONS_ONLY="$FUNCTIONS_ONLY" bash <<'EOF' 2>&1
+set -euo pipefail
+source "$FUNCTIONS_ONLY"
+mkdir -p "$LAZY_ROOT/bin"
+CCO_INSTALLATION_DIR="$LAZY_ROOT/install"
+IMAGE_NAME="cco:latest"
+cat >"$LAZY_ROOT/bin/docker" <<STUB
+#!/usr/bin/env bash
+echo "docker \$1 \$2" >>"$LAZY_ROOT/calls"
+[[ "\$1" != info ]] || echo stargz
+STUB
+chmod +x "$LAZY_ROOT/bin/docker"
+PATH="$LAZY_ROOT/bin:$PATH"
+pull_prebuilt_image
+echo "manifest checks: $(grep -c manifest "$LAZY_ROOT/calls")"
+EOF
+); then
+	assert_contains "$output" "Lazy-pulling with the stargz snapshotter" "stargz snapshotter is detected"
+	assert_contains "$output" "manifest checks: 0" "lazy pull goes straight to docker pull"
+else
+	printf '%s\n' "$output" | sed 's/^/    /'
+	fail "lazy-pulling snapshotters skip the manifest check"
+fi
+
+echo ""
+echo "Test: credential watcher syncs refreshed tokens mid-session"
+if output=$(
+	SYNC_ROOT="$TEST_ROOT/creds-sync" FUNCTIONS_ONLY="$FUNCTIONS_ONLY" bash <<'EOF' 2>&1
+set -euo pipefail
+source "$FUNCTIONS_ONLY"
+mkdir -p "$SYNC_ROOT/host" "$SYNC_ROOT/temp"
+host_file="$SYNC_ROOT/host/.credentials.json"
+printf "{\"v\":1}" >"$host_file"
+cp "$host_file" "$SYNC_ROOT/temp/.credentials.json"
+original=$(cat "$host_file")
+state="$SYNC_ROOT/temp/.sync-state"
+# Poll mode keeps the test independent of inotify-tools/fswatch
+wait_for_file_change() { sleep 0.1; }
+start_credentials_sync_watcher "$state" "$SYNC_ROOT/temp" "$host_file" "$original" "$original"
+sleep 1.1
+printf "{\"v\":2}" >"$SYNC_ROOT/temp/.credentials.json"
+for _ in $(seq 50); do
+	[[ "$(cat "$host_file")" == "{\"v\":2}" ]] && break
+	sleep 0.1
+done
+echo "mid-session: $(cat "$host_file")"
+stop_credentials_sync_watcher "$state"
+sync_credentials_incremental "$state" "$SYNC_ROOT/temp" "$host_file" "$original" "$original"
+echo "exit status: $?"
+EOF
+); then
+	assert_contains "$output" 'mid-session: {"v":2}' "refreshed credentials reach the host before exit"
+	assert_contains "$output" "exit status: 0" "exit-time sync accepts what the watcher already synced"
+	if [[ "$output" != *"SAFETY ABORT"* ]]; then
+		pass "exit-time sync does not treat the watcher's write as a conflict"
+	else
+		fail "exit-time sync does not treat the watcher's write as a conflict"
+	fi
+else
+	printf '%s\n' "$output" | sed 's/^/    /'
+	fail "credential watcher syncs refreshed tokens mid-session"
+fi
+
+echo ""
+echo "Test: concurrent sessions share a single OAuth refresh"
+if output=$(
+	FLIGHT_ROOT="$TEST_ROOT/single-flight" PATH="$FAKE_BIN:$PATH" FUNCTIONS_ONLY="$FUNCTIONS_ONLY" bash <<'EOF' 2>&1
+set -euo pipefail
+source "$FUNCTIONS_ONLY"
+mkdir -p "$FLIGHT_ROOT"
+XDG_CACHE_HOME="$FLIGHT_ROOT/cache"
+yes_flag=true
+allow_keychain=false
+SANDBOX_BACKEND="native"
+payload_file="$FLIGHT_ROOT/payload.json"
+printf "{\"expiresAt\":1}\n" >"$payload_file"
+get_claude_credentials_payload() { cat "$payload_file"; }
+oauth_refresh_lock_path() { echo "$FLIGHT_ROOT/cache/lock"; }
+run_unsandboxed_claude_refresh() {
+	echo refresh >>"$FLIGHT_ROOT/refreshes"
+	sleep 0.5
+	printf "{\"expiresAt\":4102444800000}\n" >"$payload_file"
+}
+for _ in 1 2 3; do
+	(ensure_refreshable_oauth_credentials) &
+done
+wait
+echo "refreshes: $(wc -l <"$FLIGHT_ROOT/refreshes" | tr -d " ")"
+[[ ! -d "$FLIGHT_ROOT/cache/lock" ]] && echo "lock released"
+EOF
+); then
+	assert_contains "$output" "refreshes: 1" "only one session runs the refresh"
+	assert_contains "$output" "refreshed by another cco session" "waiting sessions reuse the refreshed token"
+	assert_contains "$output" "lock released" "refresh lock is released afterwards"
+else
+	printf '%s\n' "$output" | sed 's/^/    /'
+	fail "concurrent sessions share a single OAuth refresh"
+fi
+
+echo ""
+echo "Test: state locks exclude each other and take over dead owners"
+if output=$(
+	TEST_ROOT="$TEST_ROOT" FUNCTIONS_ONLY="$FUNCTIONS_ONLY" bash <<'EOF' 2>&1
+set -euo pipefail
+source "$FUNCTIONS_ONLY"
+lock="$TEST_ROOT/state-lock/.lock"
+mkdir -p "${lock%/*}"
+for i in 1 2 3 4 5 6; do
+	(
+		for _ in 1 2 3 4 5; do
+			acquire_state_lock "$lock"
+			echo in >>"$TEST_ROOT/state-lock/log"
+			sleep 0.01
+			echo out >>"$TEST_ROOT/state-lock/log"
+			release_state_lock "$lock"
+		done
+	) &
+done
+wait
+if [[ "$(uniq "$TEST_ROOT/state-lock/log" | wc -l | tr -d " ")" == 60 ]]; then
+	echo "no overlapping owners"
+fi
+sleep 30 &
+dead=$!
+kill "$dead"
+wait "$dead" 2>/dev/null || true
+mkdir "$lock" && echo "$dead" >"$lock/pid"
+acquire_state_lock "$lock" && [[ "$(cat "$lock/pid")" == "$$" ]] && echo "dead owner taken over"
+release_state_lock "$lock"
+ls -A "${lock%/*}" | grep -v "^log$" || echo "no lock dirs left behind"
+EOF
+); then
+	assert_contains "$output" "no overlapping owners" "concurrent sessions never hold a state lock together"
+	assert_contains "$output" "dead owner taken over" "a lock left by an exited process is taken over"
+	assert_contains "$output" "no lock dirs left behind" "takeover and release leave no temp dirs"
+else
+	printf '%s\n' "$output" | sed 's/^/    /'
+	fail "state locks exclude each other and take over dead owners"
+fi
+
+echo ""
+echo "Test: the refresh prompt is shown without holding the refresh lock"
+if output=$(
+	FLIGHT_ROOT="$TEST_ROOT/prompt-lock" PATH="$FAKE_BIN:$PATH" FUNCTIONS_ONLY="$FUNCTIONS_ONLY" bash <<'EOF' 2>&1
+set -euo pipefail
+source "$FUNCTIONS_ONLY"
+mkdir -p "$FLIGHT_ROOT/cache"
+allow_keychain=false
+SANDBOX_BACKEND="native"
+get_claude_credentials_payload() { printf "{\"expiresAt\":1}\n"; }
+oauth_refresh_lock_path() { echo "$FLIGHT_ROOT/cache/lock"; }
+confirm_default_yes() {
+	[[ -d "$FLIGHT_ROOT/cache/lock" ]] && echo "prompted under the lock" || echo "prompted without the lock"
+	return 1
+}
+(ensure_refreshable_oauth_credentials) || echo "declined"
+[[ ! -d "$FLIGHT_ROOT/cache/lock" ]] && echo "lock not left behind"
+EOF
+); then
+	assert_contains "$output" "prompted without the lock" "the confirm prompt does not block other sessions"
+	assert_contains "$output" "declined" "declining the refresh stops startup"
+	assert_contains "$output" "lock not left behind" "declining leaves no refresh lock"
+else
+	printf '%s\n' "$output" | sed 's/^/    /'
+	fail "the refresh prompt is shown without holding the refresh lock"
+fi
+
+echo ""
+echo "Test: --persist re-entry attaches straight from the manifest"
+if output=$(
+	ATTACH_ROOT="$TEST_ROOT/fast-attach" FUNCTIONS_ONLY="$FUNCTIONS_ONLY" bash <<'EOF' 2>&1
+source "$FUNCTIONS_ONLY"
+mkdir -p "$ATTACH_ROOT/bin" "$ATTACH_ROOT/work"
+cd "$ATTACH_ROOT/work"
+HOME="$ATTACH_ROOT/home"
+CONTAINER_NAME="cco-work-persist-abc"
+cat >"$ATTACH_ROOT/bin/docker" <<STUB
+#!/usr/bin/env bash
+echo "docker \$*" >>"$ATTACH_ROOT/calls"
+[[ "\$1" != inspect ]] || echo "true cfg123"
+STUB
+chmod +x "$ATTACH_ROOT/bin/docker"
+PATH="$ATTACH_ROOT/bin:$PATH"
+cco_flag_args=(--persist)
+claude_args=(-p hi)
+persist_attach_key=$(hash_string "$(persist_attach_key_inputs)")
+mkdir -p "$(persist_state_dir)"
+printf "%s\n" "key=$persist_attach_key" "config_hash=cfg123" "user=1000:1000" \
+	"home=/home/hostuser" "path=/opt/shim:/usr/bin" "creds_source=" "expires_ms=4102444800000" \
+	"workdir=$PWD" >"$(persist_attach_manifest)"
+(fast_attach_persistent_container) && echo "attach status: 0"
+echo "calls: $(wc -l <"$ATTACH_ROOT/calls" | tr -d " ")"
+cat "$ATTACH_ROOT/calls"
+: >"$ATTACH_ROOT/calls"
+cco_flag_args=(--persist --docker)
+persist_attach_key=$(hash_string "$(persist_attach_key_inputs)")
+fast_attach_persistent_container || echo "changed flags take the full path"
+echo "docker calls after mismatch: $(wc -l <"$ATTACH_ROOT/calls" | tr -d " ")"
+EOF
+); then
+	assert_contains "$output" "attach status: 0" "matching manifest attaches"
+	assert_contains "$output" "calls: 3" "attach needs only inspect, exec and stop"
+	assert_contains "$output" "docker exec -u 1000:1000 -e HOME=/home/hostuser -e PATH=/opt/shim:/usr/bin -w $TEST_ROOT/fast-attach/work cco-work-persist-abc claude --dangerously-skip-permissions -p hi" \
+		"attach execs the recorded user, home and PATH"
+	assert_contains "$output" "changed flags take the full path" "a different key falls back to full startup"
+	assert_contains "$output" "docker calls after mismatch: 0" "a stale manifest is rejected without touching Docker"
+else
+	printf '%s\n' "$output" | sed 's/^/    /'
+	fail "--persist re-entry attaches straight from the manifest"
+fi
+
+echo ""
+echo "Test: the attach key covers settings directories and the worktree common dir"
+if output=$(
+	KEY_ROOT="$TEST_ROOT/attach-key" FUNCTIONS_ONLY="$FUNCTIONS_ONLY" bash <<'EOF' 2>&1
+source "$FUNCTIONS_ONLY"
+mkdir -p "$KEY_ROOT/home" "$KEY_ROOT/main/.claude"
+HOME="$KEY_ROOT/home"
+XDG_CACHE_HOME="$KEY_ROOT/cache"
+cd "$KEY_ROOT/main"
+git init -q . && git -c user.name=t -c user.email=t@t commit -q --allow-empty -m init
+git worktree add -q "$KEY_ROOT/wt" 2>/dev/null
+enable_git_worktree_common_dir=true
+allow_external_git_dir=false
+key() { hash_string "$(persist_attach_key_inputs)"; }
+printf "{\"additionalDirectories\": [\"../extra\"]}\n" >.claude/settings.local.json
+before=$(key)
+mkdir "$KEY_ROOT/extra"
+[[ "$(key)" != "$before" ]] && echo "new settings directory changes the key"
+before=$(key)
+[[ "$(key)" == "$before" ]] && echo "unchanged inputs keep the key"
+printf "{\"additionalDirectories\": []}\n" >.claude/settings.local.json
+[[ "$(key)" != "$before" ]] && echo "edited settings change the key"
+cd "$KEY_ROOT/wt"
+persist_attach_key_inputs | grep "^git_common_dir="
+EOF
+); then
+	assert_contains "$output" "new settings directory changes the key" "an entry that became a directory changes the key"
+	assert_contains "$output" "unchanged inputs keep the key" "the key is stable while nothing changes"
+	assert_contains "$output" "edited settings change the key" "editing settings.local.json changes the key"
+	assert_contains "$output" "git_common_dir=$TEST_ROOT/attach-key/main/.git" "the worktree common dir is part of the key"
+else
+	printf '%s\n' "$output" | sed 's/^/    /'
+	fail "the attach key covers settings directories and the worktree common dir"
+fi
+
+echo ""
+echo "Test: a recreated persistent container forgets the manifest's workdirs"
+if output=$(
+	TEST_ROOT="$TEST_ROOT" FUNCTIONS_ONLY="$FUNCTIONS_ONLY" bash <<'EOF' 2>&1
+set -euo pipefail
+source "$FUNCTIONS_ONLY"
+persist_state_dir_path="$TEST_ROOT/manifest-workdirs"
+temp_creds_dir="$TEST_ROOT/manifest-workdirs/creds"
+mkdir -p "$temp_creds_dir"
+persist_attach_key="samekey"
+host_uid=1000 host_gid=1000 container_home=/home/hostuser persistent_exec_path=/usr/bin creds_source_file=""
+printf "%s\n" "key=samekey" "config_hash=oldcfg" "workdir=/work/other" >"$persist_state_dir_path/attach"
+current_dir=/work/here
+persist_config_hash="oldcfg"
+record_persist_attach_manifest
+echo "same config: $(grep -c "^workdir=" "$persist_state_dir_path/attach")"
+persist_config_hash="newcfg"
+current_dir=/work/third
+record_persist_attach_manifest
+grep "^workdir=\|^config_hash=" "$persist_state_dir_path/attach"
+EOF
+); then
+	assert_contains "$output" "same config: 2" "an unchanged config keeps the recorded workdirs"
+	assert_contains "$output" $'config_hash=newcfg\nworkdir=/work/third' "a changed config keeps only the current workdir"
+else
+	printf '%s\n' "$output" | sed 's/^/    /'
+	fail "a recreated persistent container forgets the manifest's workdirs"
+fi
+
+echo ""
+echo "Test: agent shims are cached by content"
+if output=$(
+	XDG_CACHE_HOME="$TEST_ROOT/shim-cache" FUNCTIONS_ONLY="$FUNCTIONS_ONLY" bash <<'EOF' 2>&1
+set -euo pipefail
+source "$FUNCTIONS_ONLY"
+first=$(codex_mode_shim_dir)
+touch -t 200001010000 "$first/codex"
+second=$(codex_mode_shim_dir)
+[[ "$first" == "$second" && -x "$first/codex" ]] && echo "same dir reused"
+[[ -z "$(find "$first/codex" -newermt 2000-01-02)" ]] && echo "shim not rewritten"
+other=$(agent_shim_dir codex "#!/bin/sh")
+[[ "$other" != "$first" && "$(cat "$other/codex")" == "#!/bin/sh" ]] && echo "changed content gets a new dir"
+EOF
+); then
+	assert_contains "$output" "same dir reused" "unchanged shim reuses its cache dir"
+	assert_contains "$output" "shim not rewritten" "cached shim is not rewritten"
+	assert_contains "$output" "changed content gets a new dir" "changed shim content gets a new dir"
+else
+	printf '%s\n' "$output" | sed 's/^/    /'
+	fail "agent shims are cached by content"
+fi
+
 echo ""
 echo "=== Results ==="
 echo "Passed:  $PASSED"
@@ -0,0 +1,108 @@
+#!/usr/bin/env bash
+# Tests for --sync-workspace (workspace volume kept in sync by mutagen).
+# Stub docker and mutagen binaries record their calls, so this needs
+# neither Docker Desktop nor mutagen.
+
+set -euo pipefail
+
+cd "$(dirname "$0")/.."
+CCO_BIN="$PWD/cco"
+
+PASSED=0
+FAILED=0
+
+pass() {
+	echo "PASS: $1"
+	PASSED=$((PASSED + 1))
+}
+
+fail() {
+	echo "FAIL: $1"
+	FAILED=$((FAILED + 1))
+}
+
+echo "=== Workspace Sync Tests ==="
+echo "Platform: $(uname -s) ($(uname -m))"
+echo ""
+
+TEST_ROOT=$(mktemp -d)
+trap 'rm -rf "$TEST_ROOT"' EXIT
+
+STUB_BIN="$TEST_ROOT/bin"
+PROJ_DIR="$TEST_ROOT/project"
+mkdir -p "$STUB_BIN" "$PROJ_DIR" "$TEST_ROOT/home/.claude"
+cat >"$STUB_BIN/docker" <<EOF
+#!/usr/bin/env bash
+echo "docker \$*" >>"$TEST_ROOT/calls"
+if [[ "\$1" == "run" && "\$*" != *--entrypoint* ]]; then
+	printf '%s\n' "\$@" >"$TEST_ROOT/docker_run_args"
+fi
+[[ "\$1 \$2" != "volume inspect" ]] || [[ -f "$TEST_ROOT/volume" ]] || exit 1
+[[ "\$1 \$2" != "volume create" ]] || : >"$TEST_ROOT/volume"
+exit 0
+EOF
+cat >"$STUB_BIN/mutagen" <<EOF
+#!/usr/bin/env bash
+echo "mutagen \$*" >>"$TEST_ROOT/calls"
+EOF
+chmod +x "$STUB_BIN/docker" "$STUB_BIN/mutagen"
+
+run_synced() {
+	: >"$TEST_ROOT/calls"
+	(cd "$PROJ_DIR" && HOME="$TEST_ROOT/home" PATH="$STUB_BIN:$PATH" CCO_PACKAGE_CACHE=0 \
+		"$CCO_BIN" --backend docker --sync-workspace --command true) >"$TEST_ROOT/launch.log" 2>&1
+}
+
+echo "Test: the workspace is mounted from a synced volume"
+if run_synced; then
+	if grep -qx -- "cco-ws-project_*-[0-9a-f]*:$PROJ_DIR" "$TEST_ROOT/docker_run_args" &&
+		! grep -qx -- "$PROJ_DIR:$PROJ_DIR" "$TEST_ROOT/docker_run_args"; then
+		pass "the workspace is mounted from a synced volume"
+	else
+		sed 's/^/    /' "$TEST_ROOT/docker_run_args"
+		fail "the workspace is mounted from a synced volume"
+	fi
+	order=$(grep -o '^docker volume create\|^docker run -d\|^mutagen sync create\|^mutagen sync flush\|^docker run --init\|^docker run --rm --init\|^mutagen sync terminate\|^docker rm -f' "$TEST_ROOT/calls" | tr '\n' ',')
+	if [[ "$order" == "docker volume create,docker run -d,mutagen sync create,mutagen sync flush,docker run --rm --init,mutagen sync flush,mutagen sync terminate,docker rm -f," ]]; then
+		pass "sync starts and flushes before the session and is flushed and stopped after it"
+	else
+		sed 's/^/    /' "$TEST_ROOT/calls"
+		fail "sync starts and flushes before the session and is flushed and stopped after it: $order"
+	fi
+	if grep -q -- "--ignore node_modules --ignore target" "$TEST_ROOT/calls"; then
+		pass "node_modules and target stay in the volume"
+	else
+		fail "node_modules and target stay in the volume"
+	fi
+else
+	sed 's/^/    /' "$TEST_ROOT/launch.log"
+	fail "synced docker launch runs successfully"
+fi
+
+echo "Test: the volume is reused by later sessions"
+if run_synced && ! grep -q "^docker volume create" "$TEST_ROOT/calls"; then
+	pass "the volume is reused by later sessions"
+else
+	sed 's/^/    /' "$TEST_ROOT/calls"
+	fail "the volume is reused by later sessions"
+fi
+
+echo "Test: --sync-workspace needs mutagen"
+rm "$STUB_BIN/mutagen"
+if run_synced; then
+	fail "--sync-workspace needs mutagen"
+elif grep -q "needs mutagen" "$TEST_ROOT/launch.log" && [[ ! -f "$TEST_ROOT/calls" || -z "$(grep '^docker run --rm --init' "$TEST_ROOT/calls")" ]]; then
+	pass "--sync-workspace needs mutagen"
+else
+	sed 's/^/    /' "$TEST_ROOT/launch.log"
+	fail "--sync-workspace needs mutagen"
+fi
+
+echo ""
+echo "=== Results ==="
+echo "Passed: $PASSED"
+echo "Failed: $FAILED"
+
+if [[ $FAILED -gt 0 ]]; then
+	exit 1
+fi